@@ -0,0 +1,82 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "log.h"
+#include "haptic.h"
+#include "trace/trace.h"
+
+/******************************************************************************
+  Haptic alerts
+
+  Alerts requested while the timers tick are collected and emitted once per
+  wakeup, so coincident alerts give one motor activation. Only the highest
+  priority alert is played. While a pattern is still playing, an alert of the
+  same or lower priority is dropped and a higher one replaces it.
+******************************************************************************/
+static const uint32_t SEG_SHORT[]  = { 150 };
+static const uint32_t SEG_LONG[]   = { 500 };
+static const uint32_t SEG_DOUBLE[] = { 600, 200, 600 };
+static const uint32_t SEG_TRIPLE[] = { 600, 200, 600, 200, 600 };
+
+static const VibePattern PATTERNS[TIMER_VIBE_MAX] = {
+  [TIMER_VIBE_SHORT]  = { .durations = SEG_SHORT,  .num_segments = ARRAY_LENGTH(SEG_SHORT) },
+  [TIMER_VIBE_LONG]   = { .durations = SEG_LONG,   .num_segments = ARRAY_LENGTH(SEG_LONG) },
+  [TIMER_VIBE_DOUBLE] = { .durations = SEG_DOUBLE, .num_segments = ARRAY_LENGTH(SEG_DOUBLE) },
+  [TIMER_VIBE_TRIPLE] = { .durations = SEG_TRIPLE, .num_segments = ARRAY_LENGTH(SEG_TRIPLE) },
+};
+
+// total length of each pattern
+static const uint16_t PATTERN_MS[TIMER_VIBE_MAX] = {
+  [TIMER_VIBE_SHORT]  = 150,
+  [TIMER_VIBE_LONG]   = 500,
+  [TIMER_VIBE_DOUBLE] = 1400,
+  [TIMER_VIBE_TRIPLE] = 2200,
+};
+
+static HapticAlert    s_pending = HAPTIC_NONE;
+static TimerVibration s_pending_vibe = TIMER_VIBE_NONE;
+static HapticAlert    s_playing = HAPTIC_NONE;
+static uint32_t       s_playing_until_ms = 0;
+
+// vibe is only used for HAPTIC_EXPIRED, the other alerts are a short pulse
+void haptic_request(HapticAlert alert, TimerVibration vibe)
+{
+  if (alert != HAPTIC_EXPIRED)
+    vibe = TIMER_VIBE_SHORT;
+  if (vibe >= TIMER_VIBE_MAX)
+    vibe = TIMER_VIBE_NONE;
+
+  if (alert > s_pending || (alert == s_pending && vibe > s_pending_vibe))
+  {
+    s_pending = alert;
+    s_pending_vibe = vibe;
+  }
+}
+
+void haptic_flush(uint32_t now_ms)
+{
+  HapticAlert alert = s_pending;
+  TimerVibration vibe = s_pending_vibe;
+
+  s_pending = HAPTIC_NONE;
+  s_pending_vibe = TIMER_VIBE_NONE;
+
+  if (alert == HAPTIC_NONE || vibe == TIMER_VIBE_NONE)
+    return;
+
+  // nothing plays before the first alert, whatever the clock reads
+  if (s_playing != HAPTIC_NONE && (int32_t)(s_playing_until_ms - now_ms) > 0)
+  {
+    if (alert <= s_playing)
+    {
+      DEBUG("VIB merged %d", (int)alert);
+      return;
+    }
+    vibes_cancel();
+  }
+
+  vibes_enqueue_custom_pattern(PATTERNS[vibe]);
+  TRACE(TRACE_VIBE, alert << 4 | vibe);
+  s_playing = alert;
+  s_playing_until_ms = now_ms + PATTERN_MS[vibe];
+  DEBUG("VIB %d %d", (int)alert, (int)vibe);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <pebble.h>
+#include "timer.h"
+
+// Alerts in priority order, a higher one wins when they coincide
+typedef enum {
+  HAPTIC_NONE,
+  HAPTIC_INTERVAL,
+  HAPTIC_WARNING,
+  HAPTIC_EXPIRED,
+} HapticAlert;
+
+void haptic_request(HapticAlert alert, TimerVibration vibe);
+void haptic_flush(uint32_t now_ms);
@@ -0,0 +1,204 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "../log.h"
+#include "history.h"
+#include "../perf/perf.h"
+
+// The history is an append-only log of heats, stored in fixed size chunks
+// under HISTORY_CHUNK_KEY + slot. The slots are used as a ring, when the
+// last slot is filled the oldest chunk is dropped. A heat never spans two
+// chunks. Saving only writes the chunk being filled and the small index,
+// which also points at the newest heats so they load without reading the
+// whole log.
+
+#define HISTORY_VERSION     1
+#define HISTORY_INDEX_KEY   199
+#define HISTORY_CHUNK_KEY   200
+#define HISTORY_NUM_CHUNKS  8
+#define HISTORY_CHUNK_SIZE  PERSIST_DATA_MAX_LENGTH
+
+typedef struct __attribute__((__packed__)) {
+  uint8_t   size;                         // header + laps
+  uint8_t   profile;
+  uint8_t   mode;
+  uint8_t   num_laps;
+  uint32_t  start;
+  uint16_t  phase[HISTORY_NUM_PHASES];
+  uint16_t  paused;
+  uint8_t   pauses;
+} history_record_t;
+
+typedef struct {
+  uint8_t   chunk;
+  uint8_t   offset;
+} history_pos_t;
+
+typedef struct {
+  uint8_t       version;
+  uint8_t       head;                     // oldest chunk slot
+  uint8_t       tail;                     // chunk slot being filled
+  uint8_t       chunks;                   // chunk slots in use
+  uint16_t      tail_used;                // bytes used in the tail chunk
+  uint8_t       recent_count;
+  history_pos_t recent[HISTORY_RECENT];   // newest first
+} history_index_t;
+
+static history_index_t s_index;
+static uint8_t s_tail[HISTORY_CHUNK_SIZE];
+static bool s_tail_loaded = false;
+static bool s_index_loaded = false;
+
+HEAP_CHECK;
+
+static void history_index_reset(void)
+{
+  memset(&s_index, 0, sizeof(s_index));
+  s_index.version = HISTORY_VERSION;
+  s_index.chunks = 1;
+}
+
+// The history is not needed at startup, the index is read on first use
+static void history_load_index(void)
+{
+  if (s_index_loaded)
+    return;
+
+  if (0 > persist_read_data(HISTORY_INDEX_KEY, &s_index, sizeof(s_index)) ||
+      s_index.version != HISTORY_VERSION)
+  {
+    history_index_reset();
+  }
+  s_tail_loaded = false;
+  s_index_loaded = true;
+}
+
+// The tail chunk is only needed when a heat is appended
+static void history_load_tail(void)
+{
+  if (s_tail_loaded)
+    return;
+
+  memset(s_tail, 0, sizeof(s_tail));
+  if (s_index.tail_used > 0)
+  {
+    persist_read_data(HISTORY_CHUNK_KEY + s_index.tail, s_tail, sizeof(s_tail));
+  }
+  s_tail_loaded = true;
+}
+
+// Move to the next chunk slot, dropping the oldest chunk if all are used
+static void history_next_chunk(void)
+{
+  uint8_t next = (s_index.tail + 1) % HISTORY_NUM_CHUNKS;
+
+  if (s_index.chunks == HISTORY_NUM_CHUNKS)
+  {
+    s_index.head = (s_index.head + 1) % HISTORY_NUM_CHUNKS;
+    s_index.chunks--;
+
+    // forget the heats in the dropped chunk, they are the oldest
+    while (s_index.recent_count > 0 &&
+           s_index.recent[s_index.recent_count - 1].chunk == next)
+    {
+      s_index.recent_count--;
+    }
+  }
+
+  s_index.tail = next;
+  s_index.tail_used = 0;
+  s_index.chunks++;
+  memset(s_tail, 0, sizeof(s_tail));
+}
+
+void history_append(const history_heat_t *heat)
+{
+  HEAP_CHECK_START();
+  history_record_t record;
+  uint8_t num_laps = (heat->num_laps > HISTORY_MAX_LAPS) ? HISTORY_MAX_LAPS : heat->num_laps;
+  uint16_t size = sizeof(record) + num_laps * sizeof(uint16_t);
+
+  history_load_index();
+  history_load_tail();
+  if (s_index.tail_used + size > HISTORY_CHUNK_SIZE)
+  {
+    history_next_chunk();
+  }
+
+  record = (history_record_t) {
+    .size     = size,
+    .profile  = heat->profile,
+    .mode     = heat->mode,
+    .num_laps = num_laps,
+    .start    = heat->start,
+    .paused   = heat->paused,
+    .pauses   = heat->pauses,
+  };
+  memcpy(record.phase, heat->phase, sizeof(record.phase));
+
+  memcpy(&s_tail[s_index.tail_used], &record, sizeof(record));
+  memcpy(&s_tail[s_index.tail_used + sizeof(record)], heat->laps, num_laps * sizeof(uint16_t));
+
+  // newest heat first in the index
+  memmove(&s_index.recent[1], &s_index.recent[0], (HISTORY_RECENT - 1) * sizeof(history_pos_t));
+  s_index.recent[0] = (history_pos_t) { .chunk = s_index.tail, .offset = s_index.tail_used };
+  if (s_index.recent_count < HISTORY_RECENT)
+    s_index.recent_count++;
+
+  s_index.tail_used += size;
+
+  // only the tail chunk and the index are written
+  PERF_START(PERF_PERSIST);
+  if (0 > persist_write_data(HISTORY_CHUNK_KEY + s_index.tail, s_tail, s_index.tail_used) ||
+      0 > persist_write_data(HISTORY_INDEX_KEY, &s_index, sizeof(s_index)))
+  {
+    LOG("History save failed");
+  }
+  PERF_STOP(PERF_PERSIST);
+  DEBUG("History chunk %d used %d heats %d", s_index.tail, s_index.tail_used, s_index.recent_count);
+  HEAP_CHECK_STOP();
+}
+
+uint8_t history_count(void)
+{
+  history_load_index();
+  return s_index.recent_count;
+}
+
+bool history_get(uint8_t index, history_heat_t *heat)
+{
+  history_record_t record;
+  uint8_t chunk[HISTORY_CHUNK_SIZE];
+  const uint8_t *data;
+
+  history_load_index();
+  if (index >= s_index.recent_count)
+    return false;
+
+  history_pos_t pos = s_index.recent[index];
+  if (s_tail_loaded && pos.chunk == s_index.tail)
+  {
+    data = s_tail;
+  }
+  else
+  {
+    if (0 > persist_read_data(HISTORY_CHUNK_KEY + pos.chunk, chunk, sizeof(chunk)))
+      return false;
+    data = chunk;
+  }
+
+  memcpy(&record, &data[pos.offset], sizeof(record));
+  if (record.size < sizeof(record) || pos.offset + record.size > HISTORY_CHUNK_SIZE)
+    return false;
+
+  *heat = (history_heat_t) {
+    .profile  = record.profile,
+    .mode     = record.mode,
+    .start    = record.start,
+    .paused   = record.paused,
+    .pauses   = record.pauses,
+    .num_laps = record.num_laps,
+  };
+  memcpy(heat->phase, record.phase, sizeof(heat->phase));
+  memcpy(heat->laps, &data[pos.offset + sizeof(record)], record.num_laps * sizeof(uint16_t));
+  return true;
+}
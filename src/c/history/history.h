@@ -0,0 +1,30 @@
+#pragma once
+
+#include <pebble.h>
+
+#define HISTORY_MAX_LAPS    100     // laps stored with a heat, the last ones are kept
+#define HISTORY_RECENT      8       // newest heats reachable through the index
+
+typedef enum {
+  HISTORY_PHASE_PRE_RACE,
+  HISTORY_PHASE_RACE,
+  HISTORY_PHASE_AFTER_RACE,
+  HISTORY_NUM_PHASES
+} history_phase_t;
+
+typedef struct {
+  uint8_t   profile;
+  uint8_t   mode;                         // rctimer_mode_t
+  uint32_t  start;                        // wall clock at start, sec
+  uint16_t  phase[HISTORY_NUM_PHASES];    // time run in each phase, 0.1 sec
+  uint16_t  paused;                       // total time paused, sec
+  uint8_t   pauses;
+  uint8_t   num_laps;
+  uint16_t  laps[HISTORY_MAX_LAPS];       // lap times, 10 ms
+} history_heat_t;
+
+void history_append(const history_heat_t *heat);
+
+// Newest heats, index 0 is the newest one
+uint8_t history_count(void);
+bool history_get(uint8_t index, history_heat_t *heat);
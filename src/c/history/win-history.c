@@ -0,0 +1,129 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "../log.h"
+#include "../settings/settings.h"
+#include "history.h"
+#include "win-history.h"
+
+// List of the newest heats, newest first. The rows are formatted when the
+// window loads, so each heat is read from its chunk once and not on draws.
+
+#define TXT_HISTORY     "Race History"
+#define TXT_NO_HEATS    "No heats yet"
+#define ROW_STR_SIZE    24
+
+static Window *s_window;
+static MenuLayer *s_menu_layer;
+
+static uint8_t s_count = 0;
+static char s_title[HISTORY_RECENT][ROW_STR_SIZE];
+static char s_subtitle[HISTORY_RECENT][ROW_STR_SIZE];
+
+HEAP_CHECK;
+
+// Race heats show the race time, lap heats the laps and the best lap
+static void history_format(uint8_t row, const history_heat_t *heat)
+{
+  char time_str[10];
+  time_t start = heat->start;
+
+  strftime(s_title[row], ROW_STR_SIZE, "%d.%m. %H:%M", localtime(&start));
+
+  if (heat->mode == LAPTIMER_MODE)
+  {
+    uint16_t best = 0;
+    for (uint8_t i = 0; i < heat->num_laps; i++)
+    {
+      if (best == 0 || heat->laps[i] < best)
+        best = heat->laps[i];
+    }
+    timer_time_str_ms(best / 10, true, TIMER_RES_TENTH, time_str, sizeof(time_str));
+    snprintf(s_subtitle[row], ROW_STR_SIZE, "%d Laps %s", heat->num_laps, time_str);
+  }
+  else
+  {
+    timer_time_str_ms(heat->phase[HISTORY_PHASE_RACE], true, TIMER_RES_TENTH, time_str, sizeof(time_str));
+    snprintf(s_subtitle[row], ROW_STR_SIZE, "Race %s", time_str);
+  }
+}
+
+static void history_load_rows(void)
+{
+  history_heat_t *heat = malloc(sizeof(history_heat_t));
+
+  s_count = 0;
+  if (!heat)
+    return;
+
+  for (uint8_t i = 0; i < history_count(); i++)
+  {
+    if (history_get(i, heat))
+    {
+      history_format(s_count++, heat);
+    }
+  }
+  free(heat);
+}
+
+static uint16_t menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  return s_count ? s_count : 1;
+}
+
+static int16_t menu_get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  return MENU_CELL_BASIC_HEADER_HEIGHT;
+}
+
+static void menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data) {
+  menu_cell_basic_header_draw(ctx, cell_layer, TXT_HISTORY);
+}
+
+static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
+  if (s_count == 0)
+  {
+    menu_cell_title_draw(ctx, cell_layer, TXT_NO_HEATS);
+    return;
+  }
+  menu_cell_basic_draw(ctx, cell_layer, s_title[cell_index->row], s_subtitle[cell_index->row], NULL);
+}
+
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  GRect bounds = layer_get_frame(window_layer);
+
+  history_load_rows();
+
+  s_menu_layer = menu_layer_create(bounds);
+  menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks){
+    .get_num_rows = menu_get_num_rows_callback,
+    .get_header_height = menu_get_header_height_callback,
+    .draw_header = menu_draw_header_callback,
+    .draw_row = menu_draw_row_callback,
+  });
+  menu_layer_set_click_config_onto_window(s_menu_layer, window);
+#if !defined(PBL_PLATFORM_APLITE)
+  menu_layer_set_highlight_colors(s_menu_layer, GColorYellow, GColorBlack);
+#endif
+  layer_add_child(window_layer, menu_layer_get_layer(s_menu_layer));
+}
+
+static void window_unload(Window *window) {
+  menu_layer_destroy(s_menu_layer);
+}
+
+void win_history_init(void) {
+  HEAP_CHECK_START();
+  s_window = window_create();
+  window_set_window_handlers(s_window, (WindowHandlers) {
+    .load = window_load,
+    .unload = window_unload,
+  });
+  HEAP_CHECK_STOP();
+}
+
+void win_history_deinit(void) {
+  window_destroy_safe(s_window);
+}
+
+void win_history_show(void) {
+  window_stack_push(s_window, true);
+}
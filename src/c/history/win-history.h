@@ -0,0 +1,7 @@
+#pragma once
+
+#include <pebble.h>
+
+void win_history_init(void);
+void win_history_deinit(void);
+void win_history_show(void);
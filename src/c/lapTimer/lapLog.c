@@ -0,0 +1,92 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "../log.h"
+#include "lapLog.h"
+
+// Laps are stored as the delta between two splits in 10 ms units, so a lap
+// fits in 16 bit (max 655 sec). The log is a ring buffer and the statistics
+// are updated when a lap is added, so nothing is scanned.
+#define LAPLOG_UNIT_MS  10
+#define LAPLOG_MAX_LAP  0xFFFF
+
+static uint16_t s_laps[LAPLOG_SIZE];
+static uint16_t s_head = 0;           // next slot to write
+static uint16_t s_stored = 0;
+static uint16_t s_count = 0;
+
+static uint32_t s_last_split = 0;    // ms
+static uint16_t s_last = 0;
+static uint16_t s_best = 0;
+static uint32_t s_sum = 0;
+
+void laplog_reset(void)
+{
+  DEBUG("%s\n",__func__);
+  s_head = 0;
+  s_stored = 0;
+  s_count = 0;
+  s_last_split = 0;
+  s_last = 0;
+  s_best = 0;
+  s_sum = 0;
+}
+
+void laplog_add(uint32_t split_ms)
+{
+  uint32_t lap = (split_ms - s_last_split) / LAPLOG_UNIT_MS;
+  uint16_t lap16 = (lap > LAPLOG_MAX_LAP) ? LAPLOG_MAX_LAP : lap;
+
+  s_last_split = split_ms;
+
+  s_laps[s_head] = lap16;
+  s_head = (s_head + 1) % LAPLOG_SIZE;
+  if (s_stored < LAPLOG_SIZE)
+    s_stored++;
+
+  s_count++;
+  s_last = lap16;
+  s_sum += lap16;
+  if (s_best == 0 || lap16 < s_best)
+    s_best = lap16;
+
+  DEBUG("lap %d: %d best %d", s_count, (int)lap16, (int)s_best);
+}
+
+uint32_t laplog_last_split(void)
+{
+  return s_last_split;
+}
+
+uint16_t laplog_count(void)
+{
+  return s_count;
+}
+
+uint32_t laplog_last(void)
+{
+  return s_last * LAPLOG_UNIT_MS;
+}
+
+uint32_t laplog_best(void)
+{
+  return s_best * LAPLOG_UNIT_MS;
+}
+
+uint32_t laplog_average(void)
+{
+  if (s_count == 0)
+    return 0;
+  return (s_sum / s_count) * LAPLOG_UNIT_MS;
+}
+
+uint16_t laplog_stored(void)
+{
+  return s_stored;
+}
+
+uint32_t laplog_get(uint16_t index)
+{
+  if (index >= s_stored)
+    return 0;
+  return s_laps[(s_head + LAPLOG_SIZE - s_stored + index) % LAPLOG_SIZE] * LAPLOG_UNIT_MS;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <pebble.h>
+
+// Number of laps kept in the log, older laps are overwritten
+#define LAPLOG_SIZE     200
+
+void laplog_reset(void);
+void laplog_add(uint32_t split_ms);
+uint32_t laplog_last_split(void);
+
+// Statistics over all laps since reset, also the overwritten ones
+uint16_t laplog_count(void);
+uint32_t laplog_last(void);
+uint32_t laplog_best(void);
+uint32_t laplog_average(void);
+
+// Laps kept in the log, index 0 is the oldest one
+uint16_t laplog_stored(void);
+uint32_t laplog_get(uint16_t index);
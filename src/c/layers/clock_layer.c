@@ -0,0 +1,108 @@
+#include "clock_layer.h"
+#include <utils/bitmap-loader.h>
+
+// Glyph atlas: digits 0-9, then ':' and '.' in one row
+#if defined(PBL_PLATFORM_EMERY)
+#define GLYPH_DIGIT_W   22
+#define GLYPH_SEP_W     8
+#define GLYPH_H         38
+#else
+#define GLYPH_DIGIT_W   16
+#define GLYPH_SEP_W     6
+#define GLYPH_H         28
+#endif
+
+#define GLYPH_COLON     10
+#define GLYPH_DOT       11
+#define NUM_OF_GLYPHS   12
+
+#define CLOCK_TEXT_LEN  12
+
+typedef struct {
+  char text[CLOCK_TEXT_LEN];
+} ClockLayerData;
+
+static GBitmap *s_glyphs[NUM_OF_GLYPHS];
+
+static GRect glyph_rect(uint8_t glyph) {
+  if (glyph < GLYPH_COLON) {
+    return GRect(glyph * GLYPH_DIGIT_W, 0, GLYPH_DIGIT_W, GLYPH_H);
+  }
+  return GRect(GLYPH_COLON * GLYPH_DIGIT_W + (glyph - GLYPH_COLON) * GLYPH_SEP_W, 0, GLYPH_SEP_W, GLYPH_H);
+}
+
+static GBitmap* glyph_bitmap(uint8_t glyph) {
+  if (!s_glyphs[glyph]) {
+    s_glyphs[glyph] = bitmaps_get_sub_bitmap(RESOURCE_ID_DIGITS, glyph_rect(glyph));
+  }
+  return s_glyphs[glyph];
+}
+
+// Glyph index for a character, -1 for a blank cell
+static int8_t glyph_index(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c == ':') {
+    return GLYPH_COLON;
+  }
+  if (c == '.') {
+    return GLYPH_DOT;
+  }
+  return -1;
+}
+
+static int16_t glyph_width(char c) {
+  return (c == ':' || c == '.') ? GLYPH_SEP_W : GLYPH_DIGIT_W;
+}
+
+// Right aligned, vertically centered, the layer background is left to the window
+static void clock_layer_update_proc(ClockLayer* clock_layer, GContext* ctx) {
+  ClockLayerData *data = (ClockLayerData *)layer_get_data(clock_layer);
+  GRect bounds = layer_get_bounds(clock_layer);
+  int16_t x = bounds.size.w;
+  int16_t y = (bounds.size.h - GLYPH_H) / 2;
+
+  for (int i = strlen(data->text) - 1; i >= 0; i--) {
+    char c = data->text[i];
+    x -= glyph_width(c);
+
+    int8_t glyph = glyph_index(c);
+    if (glyph >= 0) {
+      graphics_draw_bitmap_in_rect(ctx, glyph_bitmap(glyph), GRect(x, y, glyph_width(c), GLYPH_H));
+    }
+  }
+}
+
+ClockLayer* clock_layer_create(GRect frame) {
+  ClockLayer *clock_layer = layer_create_with_data(frame, sizeof(ClockLayerData));
+  layer_set_update_proc(clock_layer, clock_layer_update_proc);
+
+  ClockLayerData *data = (ClockLayerData *)layer_get_data(clock_layer);
+  data->text[0] = '\0';
+
+  return clock_layer;
+}
+
+void clock_layer_destroy(ClockLayer* clock_layer) {
+  if (clock_layer) {
+    layer_destroy(clock_layer);
+  }
+}
+
+// Copies the text, only marks the layer dirty when it changed, returns true if it did
+bool clock_layer_set_text(ClockLayer* clock_layer, const char* text) {
+  ClockLayerData *data = (ClockLayerData *)layer_get_data(clock_layer);
+
+  if (strncmp(data->text, text, CLOCK_TEXT_LEN - 1) == 0) {
+    return false;
+  }
+  strncpy(data->text, text, CLOCK_TEXT_LEN - 1);
+  data->text[CLOCK_TEXT_LEN - 1] = '\0';
+  layer_mark_dirty(clock_layer);
+  return true;
+}
+
+int16_t clock_layer_get_glyph_height(void) {
+  return GLYPH_H;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <pebble.h>
+
+typedef Layer ClockLayer;
+
+ClockLayer* clock_layer_create(GRect frame);
+void clock_layer_destroy(ClockLayer* clock_layer);
+bool clock_layer_set_text(ClockLayer* clock_layer, const char* text);
+int16_t clock_layer_get_glyph_height(void);
@@ -1,24 +1,45 @@
 #include "progress_layer.h"
+#include "../perf/perf.h"
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
 
+// Bar width scale for set_value(), a reciprocal of the total in Q48. Its
+// rounding error times a value stays under one step of the bar for totals
+// below PROGRESS_SCALE_TOTAL, larger totals are divided.
+#define PROGRESS_SCALE_SHIFT 48
+#define PROGRESS_SCALE_TOTAL (1UL << 24)
+
 typedef struct {
-  int16_t progress_percent;
+  int16_t width_px;
+  uint32_t total;
+  uint64_t scale;
   int16_t corner_radius;
   GColor foreground_color;
   GColor background_color;
 } ProgressLayerData;
 
-static int16_t scale_progress_bar_width_px(unsigned int progress_percent, int16_t rect_width_px) {
-  return ((progress_percent * (rect_width_px)) / 100);
+static int16_t scale_progress_bar_width_px(uint32_t fraction, int16_t rect_width_px) {
+  return (MIN(PROGRESS_ONE, fraction) * rect_width_px) >> 16;
+}
+
+// Only marks the layer dirty when the bar width in pixels changes,
+// returns true if it did
+static bool set_width_px(ProgressLayer* progress_layer, int16_t width_px) {
+  ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
+  if (data->width_px == width_px) {
+    return false;
+  }
+  data->width_px = width_px;
+  layer_mark_dirty(progress_layer);
+  return true;
 }
 
 static void progress_layer_update_proc(ProgressLayer* progress_layer, GContext* ctx) {
+  PERF_START(PERF_PROGRESS_DRAW);
   ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
   GRect bounds = layer_get_bounds(progress_layer);
 
-  int16_t progress_bar_width_px = scale_progress_bar_width_px(data->progress_percent, bounds.size.w);
-  GRect progress_bar = GRect(bounds.origin.x, bounds.origin.y, progress_bar_width_px, bounds.size.h);
+  GRect progress_bar = GRect(bounds.origin.x, bounds.origin.y, data->width_px, bounds.size.h);
 
   graphics_context_set_fill_color(ctx, data->background_color);
   graphics_fill_rect(ctx, bounds, data->corner_radius, GCornersAll);
@@ -30,6 +51,7 @@ static void progress_layer_update_proc(ProgressLayer* progress_layer, GContext*
   graphics_context_set_stroke_color(ctx, data->background_color);
   graphics_draw_rect(ctx, progress_bar);
 #endif
+  PERF_STOP(PERF_PROGRESS_DRAW);
 }
 
 ProgressLayer* progress_layer_create(GRect frame) {
@@ -38,7 +60,9 @@ ProgressLayer* progress_layer_create(GRect frame) {
   layer_mark_dirty(progress_layer);
 
   ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
-  data->progress_percent = 0;
+  data->width_px = 0;
+  data->total = 0;
+  data->scale = 0;
   data->corner_radius = 1;
   data->foreground_color = GColorBlack;
   data->background_color = GColorWhite;
@@ -54,14 +78,47 @@ void progress_layer_destroy(ProgressLayer* progress_layer) {
 
 void progress_layer_increment_progress(ProgressLayer* progress_layer, int16_t progress) {
   ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
-  data->progress_percent = MIN(100, data->progress_percent + progress);
-  layer_mark_dirty(progress_layer);
+  int16_t rect_width_px = layer_get_bounds(progress_layer).size.w;
+  set_width_px(progress_layer, MIN(rect_width_px, data->width_px + (progress * rect_width_px) / 100));
+}
+
+bool progress_layer_set_progress(ProgressLayer* progress_layer, int16_t progress_percent) {
+  int16_t rect_width_px = layer_get_bounds(progress_layer).size.w;
+  return set_width_px(progress_layer, (MIN(100, progress_percent) * rect_width_px) / 100);
+}
+
+bool progress_layer_set_fraction(ProgressLayer* progress_layer, uint32_t fraction) {
+  int16_t rect_width_px = layer_get_bounds(progress_layer).size.w;
+  return set_width_px(progress_layer, scale_progress_bar_width_px(fraction, rect_width_px));
 }
 
-void progress_layer_set_progress(ProgressLayer* progress_layer, int16_t progress_percent) {
+// Sets what a full bar is for progress_layer_set_value(). This is the only
+// division, done once per phase: the bar width for a value is then a
+// multiply and a shift, and exactly value * width / total rounded down.
+// A phase is at most 65535 sec, 655350 tenths, well under
+// PROGRESS_SCALE_TOTAL.
+void progress_layer_set_total(ProgressLayer* progress_layer, uint32_t total) {
   ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
-  data->progress_percent = MIN(100, progress_percent);
-  layer_mark_dirty(progress_layer);
+  uint64_t rect_width_px = layer_get_bounds(progress_layer).size.w;
+
+  data->total = total;
+  data->scale = (total && total < PROGRESS_SCALE_TOTAL) ?
+                ((rect_width_px << PROGRESS_SCALE_SHIFT) + total - 1) / total : 0;
+}
+
+bool progress_layer_set_value(ProgressLayer* progress_layer, uint32_t value) {
+  ProgressLayerData *data = (ProgressLayerData *)layer_get_data(progress_layer);
+
+  if (data->total == 0) {
+    return set_width_px(progress_layer, 0);
+  }
+  if (value >= data->total) {
+    return set_width_px(progress_layer, layer_get_bounds(progress_layer).size.w);
+  }
+  if (data->scale == 0) {
+    return set_width_px(progress_layer, (uint64_t)value * layer_get_bounds(progress_layer).size.w / data->total);
+  }
+  return set_width_px(progress_layer, (value * data->scale) >> PROGRESS_SCALE_SHIFT);
 }
 
 void progress_layer_set_corner_radius(ProgressLayer* progress_layer, uint16_t corner_radius) {
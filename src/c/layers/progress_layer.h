@@ -4,10 +4,16 @@
 
 typedef Layer ProgressLayer;
 
+// Q16 fraction of a full bar
+#define PROGRESS_ONE (1UL << 16)
+
 ProgressLayer* progress_layer_create(GRect frame);
 void progress_layer_destroy(ProgressLayer* progress_layer);
 void progress_layer_increment_progress(ProgressLayer* progress_layer, int16_t progress);
-void progress_layer_set_progress(ProgressLayer* progress_layer, int16_t progress_percent);
+bool progress_layer_set_progress(ProgressLayer* progress_layer, int16_t progress_percent);
+bool progress_layer_set_fraction(ProgressLayer* progress_layer, uint32_t fraction);
+void progress_layer_set_total(ProgressLayer* progress_layer, uint32_t total);
+bool progress_layer_set_value(ProgressLayer* progress_layer, uint32_t value);
 void progress_layer_set_corner_radius(ProgressLayer* progress_layer, uint16_t corner_radius);
 void progress_layer_set_foreground_color(ProgressLayer* progress_layer, GColor color);
 void progress_layer_set_background_color(ProgressLayer* progress_layer, GColor color);
\ No newline at end of file
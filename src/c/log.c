@@ -0,0 +1,204 @@
+#include <pebble.h>
+#include <stdarg.h>
+#include <utils/pebble-assist.h>
+#define LOG_BINARY 0
+#include "log.h"
+
+#if LOG_BINARY_SIZE > 0 && !DISABLE_LOGGING
+
+#define LOG_STR_SIZE   24     // %s arguments of a record, copied when logged
+#define LOG_LINE_SIZE  128
+#define LOG_SPEC_SIZE  16
+
+typedef enum {
+  LOG_ARG_NONE,                 // no more arguments, or one not supported
+  LOG_ARG_INT,                  // %d %i %u %x %X %o %c
+  LOG_ARG_LONG,                 // the same with l
+  LOG_ARG_PTR,                  // %p
+  LOG_ARG_STR,                  // %s
+} log_arg_type_t;
+
+typedef union {
+  long        l;
+  const void *p;
+  uint8_t     str;              // offset of the copy in log_record_t.str
+} log_arg_t;
+
+// file and fmt point to string literals, they stay valid until the app exits
+typedef struct {
+  const char *file;
+  const char *fmt;
+  uint16_t    line;
+  uint8_t     level;
+  uint8_t     nargs;
+  log_arg_t   args[LOG_MAX_ARGS];
+  char        str[LOG_STR_SIZE];
+} log_record_t;
+
+static log_record_t s_log[LOG_BINARY_SIZE];
+static uint16_t s_log_next = 0;
+static uint16_t s_log_count = 0;
+static uint16_t s_log_dropped = 0;
+
+// The next conversion of *fmt, spec is set to where it starts and *fmt to
+// where it ends. %% is not a conversion.
+static log_arg_type_t log_next_arg(const char **fmt, const char **spec)
+{
+  const char *p = *fmt;
+  uint8_t longs = 0;
+
+  while ((p = strchr(p, '%')) != NULL && p[1] == '%')
+    p += 2;
+  if (p == NULL)
+    return LOG_ARG_NONE;
+
+  *spec = p++;
+  p += strspn(p, "-+ #0123456789.");
+  for (; *p == 'l' || *p == 'h'; p++)
+    longs += (*p == 'l');
+  *fmt = *p ? p + 1 : p;
+
+  switch (*p)
+  {
+    case 'd': case 'i': case 'u': case 'x': case 'X': case 'o': case 'c':
+      return (longs == 0) ? LOG_ARG_INT : (longs == 1) ? LOG_ARG_LONG : LOG_ARG_NONE;
+    case 'p':
+      return LOG_ARG_PTR;
+    case 's':
+      return LOG_ARG_STR;
+    default:
+      return LOG_ARG_NONE;
+  }
+}
+
+// Arguments are read with the type their conversion gives. A string is
+// copied, it may be gone or changed when the log is flushed. The strings of
+// a record share LOG_STR_SIZE bytes, a longer one is cut.
+void log_binary(uint8_t level, const char* file, uint16_t line, uint8_t nargs, const char* fmt, ...)
+{
+  log_record_t *record = &s_log[s_log_next];
+  const char *next = fmt, *spec;
+  uint8_t str_used = 0;
+  va_list args;
+
+  record->file = file;
+  record->fmt = fmt;
+  record->line = line;
+  record->level = level;
+  record->nargs = 0;
+  record->str[LOG_STR_SIZE - 1] = '\0';
+  if (nargs > LOG_MAX_ARGS)
+    nargs = LOG_MAX_ARGS;
+
+  va_start(args, fmt);
+  for (; record->nargs < nargs; record->nargs++)
+  {
+    log_arg_t *arg = &record->args[record->nargs];
+    log_arg_type_t type = log_next_arg(&next, &spec);
+
+    if (type == LOG_ARG_NONE)
+      break;
+    if (type == LOG_ARG_INT)
+      arg->l = va_arg(args, int);
+    else if (type == LOG_ARG_LONG)
+      arg->l = va_arg(args, long);
+    else if (type == LOG_ARG_PTR)
+      arg->p = va_arg(args, void*);
+    else
+    {
+      const char *str = va_arg(args, const char*);
+      size_t len = str ? strlen(str) : 0;
+      if (str_used + len >= LOG_STR_SIZE)
+        len = (str_used < LOG_STR_SIZE - 1) ? LOG_STR_SIZE - 1 - str_used : 0;
+      arg->str = (str_used < LOG_STR_SIZE) ? str_used : LOG_STR_SIZE - 1;
+      if (len)
+        memcpy(&record->str[arg->str], str, len);
+      record->str[arg->str + len] = '\0';
+      str_used = arg->str + len + 1;
+    }
+  }
+  va_end(args);
+
+  s_log_next = (s_log_next + 1) % LOG_BINARY_SIZE;
+  if (s_log_count < LOG_BINARY_SIZE)
+    s_log_count++;
+  else
+    s_log_dropped++;
+}
+
+// Text of the format between from and to, %% written as %
+static size_t log_append_text(char *out, size_t len, const char *from, const char *to)
+{
+  for (; from < to && len < LOG_LINE_SIZE - 1; from++)
+  {
+    out[len++] = *from;
+    if (from[0] == '%' && from + 1 < to && from[1] == '%')
+      from++;
+  }
+  out[len] = '\0';
+  return len;
+}
+
+// Each conversion is formatted on its own with the argument it was given
+static void log_format(const log_record_t *r, char *out)
+{
+  const char *fmt = r->fmt, *spec;
+  char conv[LOG_SPEC_SIZE];
+  size_t len = 0;
+
+  for (uint8_t i = 0; ; i++)
+  {
+    const char *from = fmt;
+    log_arg_type_t type = (i < r->nargs) ? log_next_arg(&fmt, &spec) : LOG_ARG_NONE;
+
+    if (type == LOG_ARG_NONE)
+    {
+      log_append_text(out, len, from, from + strlen(from));
+      return;
+    }
+    len = log_append_text(out, len, from, spec);
+
+    size_t conv_len = fmt - spec;
+    if (conv_len >= LOG_SPEC_SIZE)
+      conv_len = LOG_SPEC_SIZE - 1;
+    memcpy(conv, spec, conv_len);
+    conv[conv_len] = '\0';
+
+    int n;
+    switch (type)
+    {
+      case LOG_ARG_INT:  n = snprintf(out + len, LOG_LINE_SIZE - len, conv, (int)r->args[i].l); break;
+      case LOG_ARG_LONG: n = snprintf(out + len, LOG_LINE_SIZE - len, conv, r->args[i].l); break;
+      case LOG_ARG_PTR:  n = snprintf(out + len, LOG_LINE_SIZE - len, conv, r->args[i].p); break;
+      default:           n = snprintf(out + len, LOG_LINE_SIZE - len, conv, &r->str[r->args[i].str]); break;
+    }
+    if (n > 0)
+      len += n;
+    if (len >= LOG_LINE_SIZE - 1)
+      return;
+  }
+}
+
+// Formats and sends the buffered records, oldest first
+void log_flush(void)
+{
+  uint16_t index = (s_log_next + LOG_BINARY_SIZE - s_log_count) % LOG_BINARY_SIZE;
+  char line[LOG_LINE_SIZE];
+
+  if (s_log_dropped)
+  {
+    app_log(APP_LOG_LEVEL_WARNING, __FILE__, __LINE__, "log: %d records dropped", s_log_dropped);
+  }
+
+  while (s_log_count > 0)
+  {
+    log_record_t *r = &s_log[index];
+    log_format(r, line);
+    app_log(r->level, r->file, r->line, "%s", line);
+    index = (index + 1) % LOG_BINARY_SIZE;
+    s_log_count--;
+  }
+  s_log_dropped = 0;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+
+// Binary log: with logging enabled the LOG/DEBUG/INFO/WARN/ERROR macros only
+// store the format, line and up to LOG_MAX_ARGS arguments in a RAM ring
+// buffer, %s arguments as a copy. Formatting and the log transfer happen in
+// log_flush(). The integer, %p and %s conversions are supported.
+//
+// LOG_BINARY_SIZE records are kept, 0 leaves pebble-assist's app_log macros.
+// A module can keep app_log by defining LOG_BINARY 0 before including this.
+#ifndef LOG_BINARY_SIZE
+#define LOG_BINARY_SIZE 0
+#endif
+
+#ifndef LOG_BINARY
+#define LOG_BINARY (LOG_BINARY_SIZE > 0)
+#endif
+
+#define LOG_MAX_ARGS 4
+
+#if LOG_BINARY_SIZE > 0 && !DISABLE_LOGGING
+void log_binary(uint8_t level, const char* file, uint16_t line, uint8_t nargs, const char* fmt, ...)
+  __attribute__((format(printf, 5, 6)));
+void log_flush(void);
+#else
+#define log_flush()
+#endif
+
+#if LOG_BINARY && LOG_BINARY_SIZE > 0 && !DISABLE_LOGGING
+// number of arguments after the format, at most LOG_MAX_ARGS
+#define LOG_COUNT(...) LOG_COUNT_(__VA_ARGS__, 4, 3, 2, 1, 0, _)
+#define LOG_COUNT_(fmt, a, b, c, d, n, ...) n
+
+#undef LOG
+#undef DEBUG
+#undef INFO
+#undef WARN
+#undef ERROR
+#define LOG(...)   log_binary(APP_LOG_LEVEL_DEBUG,   __FILE__, __LINE__, LOG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#define DEBUG(...) log_binary(APP_LOG_LEVEL_DEBUG,   __FILE__, __LINE__, LOG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#define INFO(...)  log_binary(APP_LOG_LEVEL_INFO,    __FILE__, __LINE__, LOG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#define WARN(...)  log_binary(APP_LOG_LEVEL_WARNING, __FILE__, __LINE__, LOG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#define ERROR(...) log_binary(APP_LOG_LEVEL_ERROR,   __FILE__, __LINE__, LOG_COUNT(__VA_ARGS__), __VA_ARGS__)
+#endif
@@ -1,13 +1,26 @@
 #include <pebble.h>
 #include <utils/pebble-assist.h>
+#include "log.h"
 #include "rctimer.h"
 #include "settings/settings.h"
 #include "raceTimer/raceTimer.h"
 #include <utils/bitmap-loader.h>
 #include "about.h"
+#include "trace/trace.h"
 
 HEAP_CHECK;
 
+static time_t s_launch_sec;
+static uint16_t s_launch_ms;
+
+void rctimer_log_startup(const char *what) {
+#if !DISABLE_LOGGING
+  time_t sec;
+  uint16_t ms = time_ms(&sec, NULL);
+  INFO("Startup %s after %d ms", what, (int)((sec - s_launch_sec) * 1000 + ms - s_launch_ms));
+#endif
+}
+
 static void init(void) {
   HEAP_CHECK_START();
   bitmaps_init();
@@ -21,6 +34,8 @@ static void init(void) {
 static void deinit(void) {
   HEAP_CHECK_START();
   racetimer_deinit();
+  trace_dump();
+  log_flush();
   settings_deinit();
   bitmaps_cleanup();
   HEAP_CHECK_STOP();
@@ -28,9 +43,10 @@ static void deinit(void) {
 
 
 int main(void) {
+  s_launch_ms = time_ms(&s_launch_sec, NULL);
   init();
 
   app_event_loop();
 
   deinit();
-}
\ No newline at end of file
+}
\ No newline at end of file
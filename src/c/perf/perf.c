@@ -0,0 +1,71 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "perf.h"
+
+#if PERF_PROBES
+
+typedef struct {
+  uint32_t count;
+  uint32_t total_ms;
+  uint16_t min_ms;
+  uint16_t max_ms;
+} perf_stats_t;
+
+static perf_stats_t s_stats[PERF_NUM_PROBES];
+
+static const char *PERF_NAMES[PERF_NUM_PROBES] = {
+  [PERF_TIMER_TICK]    = "timer tick",
+  [PERF_UPDATE_CB]     = "update cb",
+  [PERF_PROGRESS_DRAW] = "progress draw",
+  [PERF_MENU_DRAW]     = "menu draw",
+  [PERF_PERSIST]       = "persist",
+};
+
+// Only ms resolution is available on the watch, short calls add up as 0
+uint32_t perf_now_ms(void)
+{
+  time_t seconds;
+  uint16_t millis = time_ms(&seconds, NULL);
+  return (uint32_t)seconds * 1000 + millis;
+}
+
+void perf_add(perf_probe_t probe, uint32_t ms)
+{
+  perf_stats_t *stats = &s_stats[probe];
+  uint16_t time = (ms > UINT16_MAX) ? UINT16_MAX : ms;
+
+  if (stats->count == 0 || time < stats->min_ms)
+    stats->min_ms = time;
+  if (time > stats->max_ms)
+    stats->max_ms = time;
+  stats->total_ms += ms;
+  stats->count++;
+}
+
+const char* perf_name(perf_probe_t probe)
+{
+  return PERF_NAMES[probe];
+}
+
+// count, min/avg/max in ms
+void perf_str(perf_probe_t probe, char* str, int str_len)
+{
+  perf_stats_t *stats = &s_stats[probe];
+  uint32_t avg = stats->count ? stats->total_ms / stats->count : 0;
+
+  snprintf(str, str_len, "%d %d/%d/%dms", (int)stats->count, stats->min_ms, (int)avg, stats->max_ms);
+}
+
+// Written with APP_LOG, so it is available with logging disabled
+void perf_dump(void)
+{
+  char str[32];
+
+  for (uint8_t i = 0; i < PERF_NUM_PROBES; i++)
+  {
+    perf_str(i, str, sizeof(str));
+    APP_LOG(APP_LOG_LEVEL_INFO, "PERF %s: %s total %dms", PERF_NAMES[i], str, (int)s_stats[i].total_ms);
+  }
+}
+
+#endif
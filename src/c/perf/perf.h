@@ -0,0 +1,34 @@
+#pragma once
+
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+
+// Timing probes are compiled in with logging, PERF_PROBES overrides it
+#ifndef PERF_PROBES
+#define PERF_PROBES !DISABLE_LOGGING
+#endif
+
+typedef enum {
+  PERF_TIMER_TICK,
+  PERF_UPDATE_CB,
+  PERF_PROGRESS_DRAW,
+  PERF_MENU_DRAW,
+  PERF_PERSIST,
+  PERF_NUM_PROBES
+} perf_probe_t;
+
+#if PERF_PROBES
+uint32_t perf_now_ms(void);
+void perf_add(perf_probe_t probe, uint32_t ms);
+const char* perf_name(perf_probe_t probe);
+void perf_str(perf_probe_t probe, char* str, int str_len);
+void perf_dump(void);
+
+// Times the code between them in the same scope
+#define PERF_START(probe) uint32_t perf_start_##probe = perf_now_ms()
+#define PERF_STOP(probe)  perf_add(probe, perf_now_ms() - perf_start_##probe)
+#else
+#define PERF_START(probe)
+#define PERF_STOP(probe)
+#define perf_dump()
+#endif
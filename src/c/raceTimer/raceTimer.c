@@ -1,12 +1,19 @@
 #include <pebble.h>
 #include <utils/pebble-assist.h>
+#include "../log.h"
 #include <utils/bitmap-loader.h>
-#include "../rcTimer.h"
+#include "../rctimer.h"
 #include "../settings/settings.h"
 #include "../timer.h"
 #include "../icons.h"
 
 #include "../layers/progress_layer.h"
+#include "../layers/clock_layer.h"
+#include "../lapTimer/lapLog.h"
+#include "../history/history.h"
+#include "../trace/trace.h"
+#include "../haptic.h"
+#include "worker_msg.h"
 
 typedef enum
 {
@@ -24,32 +31,37 @@ typedef enum
   x(EVENT_TIMER_EXPIRED)  \
   x(EVENT_CLICK_UP)       \
   x(EVENT_CLICK_DOWN)     \
-  x(EVENT_SETTINGS)
+  x(EVENT_CLICK_SELECT)
 
 typedef enum
 {
   EVENTS(GENERATE_ENUM)
+  NUM_EVENTS
 }racetimer_event;
 
+#if !DISABLE_LOGGING
 static const char *EVENTS_STRING[] = {
     EVENTS(GENERATE_STRING)
 };
+#endif
 
 #define STATES(x)           \
   x(STATE_STOPPED)          \
   x(STATE_PAUSED)           \
-  x(STATE_PRE_RACE_RUNNING) \
-  x(STATE_RACE_RUNNING)     \
-  x(STATE_AFTER_RACE_RUNNING)
+  x(STATE_PHASE_RUNNING)    \
+  x(STATE_LAP_RUNNING)
 
 typedef enum
 {
   STATES(GENERATE_ENUM)
+  NUM_STATES
 }racetimer_state;
 
+#if !DISABLE_LOGGING
 static const char *STATES_STRING[] = {
     STATES(GENERATE_STRING)
 };
+#endif
 
 
 /*
@@ -75,6 +87,13 @@ typedef enum
 
 #define STATUS_BAR_HEIGHT 16
 
+#define NUM_PROFILE_ICONS 5
+static const GRect PROFILE_ICONS[NUM_PROFILE_ICONS] = {
+  ICON_RECT_1, ICON_RECT_2, ICON_RECT_3, ICON_RECT_4, ICON_RECT_5
+};
+
+#define RACETIMER_SNAPSHOT_KEY 151   // This key holds the run state of a heat over a relaunch
+
 
 // platform colors
 #if defined(PBL_PLATFORM_APLITE)
@@ -89,24 +108,69 @@ typedef enum
 
 
 static Window *window;
-static TextLayer *title_layer, *pretimer_layer, *timer_layer;
+static TextLayer *title_layer;
+static ClockLayer *pretimer_layer, *timer_layer;
 static Timer rctimer;
-static char pretime_str[10], time_str[10];
+static char pretime_str[10], time_str[10], title_str[16];
+
+#if !DISABLE_LOGGING
+// layers marked dirty by the update callbacks
+static uint32_t s_redraws = 0;
+#define COUNT_REDRAW() s_redraws++
+#else
+#define COUNT_REDRAW()
+#endif
 
 ActionBarLayer *action_bar;
 static GBitmap *s_icon_start, *s_icon_stop, *s_icon_pause, *s_icon_settings, *s_icon_profile;
 static ProgressLayer *s_progress_layer;
-static uint16_t s_progress = 0;
-static uint16_t s_progress_size = 0;
+static uint32_t s_progress = 0;
+static uint32_t s_progress_size = 0;
 
 static StatusBarLayer *status_bar_layer;
 
+// heat being recorded for the history
+static history_heat_t s_heat;
+static bool s_heat_running = false;
+static history_phase_t s_heat_phase;
+static time_t s_pause_start;
+
+// program of the heat and the phase of it running, the phases are read once
+// when a phase starts, the timer callbacks do not look at the settings
+static const settings_program_t *s_program;
+static const settings_phase_t *s_phase;
+static uint8_t s_phase_index = 0;
+
 static racetimer_state prev_state = STATE_STOPPED;
 static racetimer_state state = STATE_STOPPED;
 
 static void racetimer_event_handler(racetimer_event event);
 static void racetimer_event_handler_with_clicks(racetimer_event event, uint8_t clicks);
 
+// Events from the buttons and the timer are queued and handled by the state
+// machine from the event loop, in order, once the current callback returned
+#define EVENT_QUEUE_SIZE 8
+
+typedef struct
+{
+  racetimer_event event;
+  uint8_t         clicks;
+  uint32_t        time_ms;    // wall clock when queued
+}racetimer_queued_event;
+
+static racetimer_queued_event s_queue[EVENT_QUEUE_SIZE];
+static uint8_t s_queue_head = 0;
+static uint8_t s_queue_count = 0;
+static AppTimer *s_queue_drain = NULL;
+
+// a held up button reset the heat, its repeats are dropped until released
+static bool s_up_reset = false;
+
+// clicks of the up events the drain handles before the state machine, the
+// repeat and the release go through the queue in the order they came
+#define CLICKS_UP_REPEAT  0xFE
+#define CLICKS_UP_RELEASE 0xFF
+
 HEAP_CHECK
 
 
@@ -122,90 +186,217 @@ void deinit_statusbar(void)
   status_bar_layer_destroy(status_bar_layer);
 }
 
-static void pre_race_update_cb(void* context) {
+/******************************************************************************
+  Change driven redraw
+
+  The update callbacks run on every timer tick, but the visible text and the
+  bar width change far less often. The layers keep what they show and are
+  only marked dirty when it differs.
+******************************************************************************/
+static void racetimer_update_text(ClockLayer *layer, const char *text)
+{
+  if (clock_layer_set_text(layer, text))
+  {
+    COUNT_REDRAW();
+  }
+}
+
+static void racetimer_update_progress(uint32_t value)
+{
+  if (progress_layer_set_value(s_progress_layer, value))
+  {
+    COUNT_REDRAW();
+  }
+}
+
+uint32_t racetimer_debug_redraws(void)
+{
+#if !DISABLE_LOGGING
+  return s_redraws;
+#else
+  return 0;
+#endif
+}
+
+// The phase type picks the line and what the bar shows, a counting up phase
+// has no length to show on the bar
+static void phase_update_cb(void* context) {
   DEBUG("%s\n",__func__);
-  timer_time_str_ms(timer_get_time(rctimer), false, pretime_str,sizeof(pretime_str));
-  s_progress = timer_get_time(rctimer);
+  uint32_t time = timer_get_time(rctimer);
 
-  text_layer_set_text(pretimer_layer, pretime_str);
-  progress_layer_set_progress(s_progress_layer, (s_progress*100)/s_progress_size);
+  switch (s_phase->type)
+  {
+    case SETTINGS_PHASE_PRE_RACE:
+      timer_time_str_ms(time, false, s_phase->resolution, pretime_str,sizeof(pretime_str));
+      racetimer_update_text(pretimer_layer, pretime_str);
+      s_progress = time;
+      break;
+    case SETTINGS_PHASE_RACE:
+      timer_time_str_ms(time, true, s_phase->resolution, time_str,sizeof(time_str));
+      racetimer_update_text(timer_layer, time_str);
+      s_progress = s_progress_size - time;
+      break;
+    default:
+      timer_time_str_ms(time, true, s_phase->resolution, time_str,sizeof(time_str));
+      racetimer_update_text(timer_layer, time_str);
+      DEBUG("timer:%s redraws:%d",time_str,(int)racetimer_debug_redraws());
+      return;
+  }
 
-  DEBUG("pretimer:%s %d",pretime_str,s_progress);
+  if (s_progress_size)
+  {
+    racetimer_update_progress(s_progress);
+  }
+  DEBUG("timer:%s %lu redraws:%d",time_str,(unsigned long)s_progress,(int)racetimer_debug_redraws());
 }
 
-static void race_update_cb(void* context) {
+static void lap_update_cb(void* context) {
   DEBUG("%s\n",__func__);
+  uint32_t lap_ms = timer_get_elapsed_ms(rctimer) - laplog_last_split();
 
-  timer_time_str_ms(timer_get_time(rctimer), true, time_str,sizeof(time_str));
-  text_layer_set_text(timer_layer, time_str);
+  timer_time_str_ms(lap_ms / 100, true, TIMER_RES_TENTH, time_str,sizeof(time_str));
+  racetimer_update_text(timer_layer, time_str);
 
-  s_progress = s_progress_size - timer_get_time(rctimer);
+  // current lap against the average lap
+  racetimer_update_progress(lap_ms);
+}
 
-  progress_layer_set_progress(s_progress_layer, (s_progress*100)/s_progress_size);
-  DEBUG("timer:%s %d",time_str,s_progress);
+/******************************************************************************
+  Event queue
+******************************************************************************/
+static uint32_t racetimer_now_ms(void)
+{
+  time_t seconds;
+  uint16_t millis = time_ms(&seconds, NULL);
+  return (uint32_t)seconds * 1000 + millis;
 }
 
-static void after_race_update_cb(void* context) {
-  DEBUG("%s\n",__func__);
-  timer_time_str_ms(timer_get_time(rctimer), true, time_str,sizeof(time_str));
-  text_layer_set_text(timer_layer, time_str);
+// Up repeats and releases against the state they are handled in, false if
+// the event goes no further
+static bool racetimer_queued_up(racetimer_queued_event *queued)
+{
+  if (queued->clicks == CLICKS_UP_RELEASE)
+  {
+    s_up_reset = false;
+    return false;
+  }
+  if (s_up_reset)
+    return false;
+  // the repeat that resets a heat is the last one until up is released
+  if (state != STATE_STOPPED)
+    s_up_reset = true;
+  queued->clicks = settings_get_active_profile() + 1;
+  return true;
+}
+
+static void racetimer_queue_drain(void* context)
+{
+  s_queue_drain = NULL;
+
+  // events queued while draining wait for the next run
+  uint8_t count = s_queue_count;
+  while (count-- > 0 && s_queue_count > 0)
+  {
+    racetimer_queued_event queued = s_queue[s_queue_head];
+    s_queue_head = (s_queue_head + 1) % EVENT_QUEUE_SIZE;
+    s_queue_count--;
+
+    DEBUG("queued %s %dms", EVENTS_STRING[queued.event], (int)(racetimer_now_ms() - queued.time_ms));
+    if (queued.event == EVENT_CLICK_UP && queued.clicks >= CLICKS_UP_REPEAT && !racetimer_queued_up(&queued))
+      continue;
+    racetimer_event_handler_with_clicks(queued.event, queued.clicks);
+  }
+
+  if (s_queue_count > 0 && !s_queue_drain)
+    s_queue_drain = app_timer_register(0, racetimer_queue_drain, NULL);
+}
+
+// coalesce drops the event if the same one is still waiting at the tail
+static void racetimer_post_event(racetimer_event event, uint8_t clicks, bool coalesce)
+{
+  if (coalesce && s_queue_count > 0)
+  {
+    racetimer_queued_event *last = &s_queue[(s_queue_head + s_queue_count - 1) % EVENT_QUEUE_SIZE];
+    if (last->event == event && last->clicks == clicks)
+    {
+      DEBUG("coalesced %s", EVENTS_STRING[event]);
+      return;
+    }
+  }
+
+  if (s_queue_count == EVENT_QUEUE_SIZE)
+  {
+    WARN("event queue full, %s dropped", EVENTS_STRING[event]);
+    return;
+  }
+
+  racetimer_queued_event *queued = &s_queue[(s_queue_head + s_queue_count) % EVENT_QUEUE_SIZE];
+  queued->event = event;
+  queued->clicks = clicks;
+  queued->time_ms = racetimer_now_ms();
+  s_queue_count++;
+
+  if (!s_queue_drain)
+    s_queue_drain = app_timer_register(0, racetimer_queue_drain, NULL);
+}
 
-  DEBUG("timer:%s %d",time_str,s_progress);
+static void racetimer_queue_reset(void)
+{
+  app_timer_cancel_safe(s_queue_drain);
+  s_queue_head = 0;
+  s_queue_count = 0;
 }
 
 static void timer_expired_cb(void* context) {
   DEBUG("%s\n",__func__);
-  racetimer_event_handler(EVENT_TIMER_EXPIRED);
+  racetimer_post_event(EVENT_TIMER_EXPIRED, 0, false);
 }
 
 
 static void up_repeat_click_handler(ClickRecognizerRef recognizer, void *context)
 {
-  racetimer_event_handler_with_clicks(EVENT_CLICK_UP, (settings_get_active_profile() + 1));
+  // repeats not handled yet select the same profile
+  racetimer_post_event(EVENT_CLICK_UP, CLICKS_UP_REPEAT, true);
+}
+
+static void up_raw_up_handler(ClickRecognizerRef recognizer, void *context)
+{
+  racetimer_post_event(EVENT_CLICK_UP, CLICKS_UP_RELEASE, false);
 }
 
 static void up_click_handler(ClickRecognizerRef recognizer, void *context)
 {
-  racetimer_event_handler_with_clicks(EVENT_CLICK_UP, (click_number_of_clicks_counted(recognizer)-1));
+  racetimer_post_event(EVENT_CLICK_UP, (click_number_of_clicks_counted(recognizer)-1), false);
 }
 
 static void select_click_handler(ClickRecognizerRef recognizer, void *context)
 {
-  racetimer_event_handler(EVENT_SETTINGS);
+  racetimer_post_event(EVENT_CLICK_SELECT, 0, false);
 }
 
 static void down_click_handler(ClickRecognizerRef recognizer, void *context)
 {
-  racetimer_event_handler(EVENT_CLICK_DOWN);
+  racetimer_post_event(EVENT_CLICK_DOWN, 0, false);
 }
 
 static void click_config_provider(void *context) {
+  // clicks select one of the first profiles, holding up steps through all
+  uint8_t clicks = settings_get_num_of_profiles();
+  if (clicks > NUM_PROFILE_ICONS)
+    clicks = NUM_PROFILE_ICONS;
+
   window_single_repeating_click_subscribe(BUTTON_ID_UP, 500, up_repeat_click_handler);
-  window_multi_click_subscribe(BUTTON_ID_UP,      1, settings_get_num_of_profiles(), 300, true, up_click_handler);
+  window_raw_click_subscribe(BUTTON_ID_UP, NULL, up_raw_up_handler, NULL);
+  window_multi_click_subscribe(BUTTON_ID_UP,      1, clicks, 300, true, up_click_handler);
   window_single_click_subscribe(BUTTON_ID_SELECT, select_click_handler);
   window_single_click_subscribe(BUTTON_ID_DOWN,   down_click_handler);
 }
 
+// Profiles after the numbered icons show the up down icon
 static void SetProfileIcon(uint8_t id)
 {
-  switch(id)
-  {
-    case 0:
-      s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_1);
-      break;
-    case 1:
-      s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_2);
-      break;
-    case 2:
-      s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_3);
-      break;
-    case 3:
-      s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_4);
-      break;
-    case 4:
-      s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_5);
-      break;
-  }
+  s_icon_profile = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS,
+                                          (id < NUM_PROFILE_ICONS) ? PROFILE_ICONS[id] : ICON_RECT_UP_DOWN);
 }
 
 static void SetActionBarIcons(racetimer_icons icons)
@@ -221,6 +412,11 @@ static void SetActionBarIcons(racetimer_icons icons)
     }
     break;
     case ICONS_RUNNING:
+      if (!s_icon_pause)
+      {
+        s_icon_stop = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_STOP);
+        s_icon_pause = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_PAUSE);
+      }
       action_bar_layer_set_icon(action_bar, BUTTON_ID_UP, s_icon_stop);
       action_bar_layer_clear_icon(action_bar, BUTTON_ID_SELECT);
       action_bar_layer_set_icon(action_bar,   BUTTON_ID_DOWN,   s_icon_pause);
@@ -235,18 +431,174 @@ static void SetActionBarIcons(racetimer_icons icons)
   }
 }
 
+/******************************************************************************
+  Heat history
+******************************************************************************/
+// A program may run several phases of a type, their times add up
+static void racetimer_heat_phase_end(void)
+{
+  uint32_t time = s_heat.phase[s_heat_phase] + timer_get_elapsed_ms(rctimer) / 100;
+  s_heat.phase[s_heat_phase] = (time > UINT16_MAX) ? UINT16_MAX : time;
+}
+
+// Called when a phase starts, before the timer is reset for it
+static void racetimer_heat_phase(history_phase_t phase)
+{
+  if (s_heat_running)
+  {
+    racetimer_heat_phase_end();
+  }
+  else
+  {
+    memset(&s_heat, 0, sizeof(s_heat));
+    s_heat.profile = settings_get_active_profile();
+    s_heat.mode = settings_get_mode();
+    s_heat.start = time(NULL);
+    s_heat_running = true;
+  }
+  s_heat_phase = phase;
+}
+
+static void racetimer_heat_end(void)
+{
+  if (!s_heat_running)
+    return;
+
+  racetimer_heat_phase_end();
+  if (timer_get_status(rctimer) == TIMER_STATUS_PAUSED)
+  {
+    s_heat.paused += time(NULL) - s_pause_start;
+  }
+
+  // keep the last laps
+  uint16_t stored = laplog_stored();
+  uint16_t first = (stored > HISTORY_MAX_LAPS) ? stored - HISTORY_MAX_LAPS : 0;
+  s_heat.num_laps = stored - first;
+  for (uint16_t i = 0; i < s_heat.num_laps; i++)
+  {
+    s_heat.laps[i] = laplog_get(first + i) / 10;
+  }
+
+  history_append(&s_heat);
+  s_heat_running = false;
+}
+
+/******************************************************************************
+  Background worker
+******************************************************************************/
+// Hand a running heat over to the worker, it launches the app again when
+// the EOR warning of a timed phase starts and when the phase is over, so the
+// app gives their alerts. The phases after the running one end one after the
+// other, up to the first one counting up. Without a heat the worker is not
+// needed any more.
+static void racetimer_worker_handover(void)
+{
+  worker_heat_t heat;
+  uint32_t now = time(NULL);
+  uint32_t end;
+  uint8_t n = 0;
+
+  if (state != STATE_PHASE_RUNNING || s_phase->duration == 0)
+  {
+    if (app_worker_is_running())
+    {
+      app_worker_kill();
+    }
+    return;
+  }
+
+  memset(&heat, 0, sizeof(heat));
+  end = now + (timer_get_time(rctimer) + 9) / 10;
+  for (uint8_t i = s_phase_index; i < s_program->num_phases && n < WORKER_MAX_LAUNCHES; i++)
+  {
+    const settings_phase_t *phase = &s_program->phases[i];
+    if (phase->duration == 0)
+      break;
+    if (i > s_phase_index)
+      end += phase->duration;
+    if (phase->warning && end - phase->warning > now)
+      heat.launch[n++] = end - phase->warning;
+    if (n < WORKER_MAX_LAUNCHES)
+      heat.launch[n++] = end;
+  }
+
+  DEBUG("%s phase %d launch at %lu, heat ends %lu\n", __func__, s_phase_index, (unsigned long)heat.launch[0], (unsigned long)end);
+  persist_write_data(WORKER_HEAT_KEY, &heat, sizeof(heat));
+  if (app_worker_is_running())
+  {
+    AppWorkerMessage msg = { 0 };
+    app_worker_send_message(WORKER_MSG_HEAT_CHANGED, &msg);
+  }
+  else
+  {
+    app_worker_launch();
+  }
+}
+
+// The app is in the foreground again, the worker is kept for the next time
+// it is closed but forgets the heat
+static void racetimer_worker_stop(void)
+{
+  if (app_worker_is_running())
+  {
+    AppWorkerMessage msg = { 0 };
+    app_worker_send_message(WORKER_MSG_HEAT_STOP, &msg);
+  }
+  persist_delete(WORKER_HEAT_KEY);
+}
+
 static void racetimer_reset(void)
 {
   DEBUG("%s\n",__func__);
+  racetimer_heat_end();
   timer_reset(rctimer);
 
+  if (settings_get_mode() == LAPTIMER_MODE)
+  {
+    laplog_reset();
+    text_layer_set_text(title_layer, "Lap Timer");
+    clock_layer_set_text(pretimer_layer, "");
+    progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR);
+    progress_layer_set_progress(s_progress_layer, 0);
+    timer_time_str_ms(0, true, TIMER_RES_TENTH, time_str,sizeof(time_str));
+    clock_layer_set_text(timer_layer, time_str);
+
+    SetActionBarIcons(ICONS_STOPPED);
+    return;
+  }
+
+  if (settings_get_active_profile() < NUM_PROFILE_ICONS)
+  {
+    text_layer_set_text(title_layer, "Race Timer");
+  }
+  else
+  {
+    // no icon for the profile, its name is the title
+    settings_get_profile_name(settings_get_active_profile(), title_str, sizeof(title_str));
+    text_layer_set_text(title_layer, title_str);
+  }
   progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR_PRETIMER);
   progress_layer_set_progress(s_progress_layer, 100);
 
-  timer_time_str_ms(settings()->pre_race_duration*10, false, pretime_str,sizeof(pretime_str));
-  text_layer_set_text(pretimer_layer, pretime_str);
-  timer_time_str_ms(settings()->race_duration*10, true, time_str,sizeof(time_str));
-  text_layer_set_text(timer_layer, time_str);
+  // the first phase of each line shows its length
+  s_program = settings_program();
+  pretime_str[0] = '\0';
+  time_str[0] = '\0';
+  for (uint8_t i = 0; i < s_program->num_phases; i++)
+  {
+    const settings_phase_t *phase = &s_program->phases[i];
+    if (phase->type == SETTINGS_PHASE_PRE_RACE)
+    {
+      if (!pretime_str[0])
+        timer_time_str_ms(phase->duration*10, false, phase->resolution, pretime_str,sizeof(pretime_str));
+    }
+    else if (!time_str[0])
+    {
+      timer_time_str_ms(phase->duration*10, true, phase->resolution, time_str,sizeof(time_str));
+    }
+  }
+  clock_layer_set_text(pretimer_layer, pretime_str);
+  clock_layer_set_text(timer_layer, time_str);
 
   SetActionBarIcons(ICONS_STOPPED);
 }
@@ -255,68 +607,356 @@ void racetimer_pause(void)
 {
   DEBUG("%s\n",__func__);
   timer_pause(rctimer);
+  s_heat.pauses++;
+  s_pause_start = time(NULL);
   SetActionBarIcons(ICONS_PAUSED);
 }
 
-static void racetimer_start_pre_race(void)
+// Phase types are in the order of the history phases
+static void racetimer_start_phase(uint8_t index)
 {
-  DEBUG("%s\n",__func__);
+  DEBUG("%s %d\n",__func__, index);
+  // the phase starts where the one before ended, not at the wakeup that saw it
+  uint32_t late_ms = timer_get_overrun_ms(rctimer);
+
+  s_phase_index = index;
+  s_phase = &s_program->phases[index];
+
+  racetimer_heat_phase((history_phase_t)s_phase->type);
   timer_reset(rctimer);
-  timer_set_length(rctimer, settings()->pre_race_duration);
-  timer_set_interval_vibration(rctimer, settings()->pre_race_interval);
-  timer_set_expired_vibration(rctimer, settings()->pre_race_over_vibe);
-  timer_register_update_cb(rctimer, pre_race_update_cb, NULL);
+  timer_set_length(rctimer, s_phase->duration);
+  timer_set_interval_vibration(rctimer, s_phase->interval);
+  timer_set_expired_vibration(rctimer, s_phase->end_vibe);
+  timer_set_display_resolution(rctimer, s_phase->resolution);
+  timer_set_before_expire_warning_length(rctimer, s_phase->warning);
+  timer_set_alert_points(rctimer, s_phase->alerts, SETTINGS_MAX_ALERTS);
+  timer_register_update_cb(rctimer, phase_update_cb, NULL);
   timer_register_expired_cb(rctimer, timer_expired_cb, NULL);
 
-  s_progress_size = settings()->pre_race_duration*10;
+  switch (s_phase->type)
+  {
+    case SETTINGS_PHASE_PRE_RACE:
+      s_progress_size = s_phase->duration*10;
+      progress_layer_set_total(s_progress_layer, s_progress_size);
+      progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR_PRETIMER);
+      break;
+    case SETTINGS_PHASE_RACE:
+      s_progress_size = s_phase->duration*10;
+      progress_layer_set_total(s_progress_layer, s_progress_size);
+      progress_layer_set_value(s_progress_layer, 0);
+      progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR);
+      break;
+    default:
+      // the bar keeps what the phase before left
+      break;
+  }
 
   timer_start(rctimer);
+  if (late_ms)
+    timer_set_elapsed_ms(rctimer, late_ms);
   SetActionBarIcons(ICONS_RUNNING);
 }
 
-static void racetimer_start_race(void)
+static void racetimer_start_lap(void)
 {
   DEBUG("%s\n",__func__);
+  racetimer_heat_phase(HISTORY_PHASE_RACE);
   timer_reset(rctimer);
-  timer_set_length(rctimer, settings()->race_duration);
-  timer_set_interval_vibration(rctimer, settings()->race_interval);
-  timer_set_expired_vibration(rctimer, settings()->race_over_vibe);
-  timer_set_before_expire_warning_length(rctimer,settings()->race_over_warning);
-  timer_register_update_cb(rctimer, race_update_cb,NULL);
-  timer_register_expired_cb(rctimer, timer_expired_cb, NULL);
+  timer_set_length(rctimer, 0);
+  timer_set_display_resolution(rctimer, TIMER_RES_TENTH);
+  timer_register_update_cb(rctimer, lap_update_cb, NULL);
 
-  s_progress_size = settings()->race_duration*10;
-  progress_layer_set_progress(s_progress_layer, s_progress);
-  progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR);
+  laplog_reset();
+  progress_layer_set_total(s_progress_layer, 0);
+  snprintf(title_str, sizeof(title_str), "Lap %d", 1);
+  text_layer_set_text(title_layer, title_str);
 
   timer_start(rctimer);
   SetActionBarIcons(ICONS_RUNNING);
 }
 
-static void racetimer_start_after_race(void)
+static void racetimer_lap(void)
 {
   DEBUG("%s\n",__func__);
-  timer_reset(rctimer);
-  timer_set_length(rctimer, 0);
-  timer_set_interval_vibration(rctimer, settings()->after_race_interval);
-  timer_register_update_cb(rctimer, after_race_update_cb,NULL);
+  laplog_add(timer_get_elapsed_ms(rctimer));
+  // the running lap is measured against the new average
+  progress_layer_set_total(s_progress_layer, laplog_average());
 
-  timer_start(rctimer);
-  SetActionBarIcons(ICONS_RUNNING);
+  // last lap on the upper line, the running lap continues below
+  timer_time_str_ms(laplog_last() / 100, true, TIMER_RES_TENTH, pretime_str,sizeof(pretime_str));
+  clock_layer_set_text(pretimer_layer, pretime_str);
+  snprintf(title_str, sizeof(title_str), "Lap %d", laplog_count() + 1);
+  text_layer_set_text(title_layer, title_str);
+
+  DEBUG("best %d avg %d", (int)laplog_best(), (int)laplog_average());
 }
 
 void racetimer_resume(void)
 {
   DEBUG("%s\n",__func__);
+  s_heat.paused += time(NULL) - s_pause_start;
   timer_start(rctimer);
   SetActionBarIcons(ICONS_RUNNING);
 }
 
 static void racetimer_setting_cb(void)
 {
-  racetimer_event_handler(EVENT_INIT);
+  racetimer_post_event(EVENT_INIT, 0, false);
+}
+
+/******************************************************************************
+  Run state snapshot
+
+  A race heat survives closing the app. The phase start is kept as a wall
+  clock time, so the restored clock is exact however long the app was closed.
+  Lap mode is not kept, its lap log is only held in memory.
+******************************************************************************/
+typedef struct {
+  uint8_t   state;        // racetimer_state, running or paused
+  uint8_t   phase;        // phase of the program
+  uint8_t   num_phases;   // of the program, a changed program is not continued
+  uint8_t   profile;      // id, kept when the profiles before it are deleted
+  uint8_t   pauses;
+  uint32_t  start_ms;     // wall clock (ms) at which the phase time was 0
+  uint32_t  paused_ms;    // phase time when paused
+  uint32_t  pause_start;  // wall clock, sec
+  uint32_t  heat_start;   // wall clock, sec
+  uint16_t  heat_phase[HISTORY_NUM_PHASES];
+  uint16_t  heat_paused;
+} racetimer_snapshot_t;
+
+static void racetimer_snapshot_save(void)
+{
+  racetimer_snapshot_t snap;
+
+  if (!s_heat_running || settings_get_mode() != RACETIMER_MODE)
+    return;
+
+  memset(&snap, 0, sizeof(snap));
+  snap.state = state;
+  snap.phase = s_phase_index;
+  snap.num_phases = s_program->num_phases;
+  snap.profile = settings_get_active_profile_id();
+  snap.pauses = s_heat.pauses;
+  snap.paused_ms = timer_get_elapsed_ms(rctimer);
+  snap.start_ms = racetimer_now_ms() - snap.paused_ms;
+  snap.pause_start = s_pause_start;
+  snap.heat_start = s_heat.start;
+  memcpy(snap.heat_phase, s_heat.phase, sizeof(snap.heat_phase));
+  snap.heat_paused = s_heat.paused;
+
+  DEBUG("%s %s phase %d", __func__, STATES_STRING[snap.state], snap.phase);
+  persist_write_data(RACETIMER_SNAPSHOT_KEY, &snap, sizeof(snap));
+
+  // the heat goes on, it is recorded when it ends after the relaunch
+  s_heat_running = false;
+}
+
+// Returns false if there is no heat to continue
+static bool racetimer_snapshot_restore(void)
+{
+  racetimer_snapshot_t snap;
+  int read = persist_read_data(RACETIMER_SNAPSHOT_KEY, &snap, sizeof(snap));
+  persist_delete(RACETIMER_SNAPSHOT_KEY);
+
+  if (read != sizeof(snap) || settings_get_mode() != RACETIMER_MODE ||
+      snap.profile != settings_get_active_profile_id())
+    return false;
+
+  s_program = settings_program();
+  if (snap.num_phases != s_program->num_phases || snap.phase >= s_program->num_phases)
+    return false;
+
+  uint8_t phase = snap.phase;
+  uint32_t elapsed = (snap.state == STATE_PAUSED) ? snap.paused_ms : racetimer_now_ms() - snap.start_ms;
+  TimerVibration vibe = TIMER_VIBE_NONE;
+
+  // skip the phases that ended while the app was closed, the last phase
+  // is never skipped
+  while (phase + 1 < s_program->num_phases && s_program->phases[phase].duration &&
+         elapsed >= s_program->phases[phase].duration * 1000u)
+  {
+    const settings_phase_t *ended = &s_program->phases[phase];
+    uint32_t time = snap.heat_phase[ended->type] + ended->duration * 10;
+    snap.heat_phase[ended->type] = (time > UINT16_MAX) ? UINT16_MAX : time;
+    elapsed -= ended->duration * 1000u;
+    vibe = ended->end_vibe;
+    phase++;
+  }
+  // left behind for longer than the history can hold, the heat is recorded
+  // with the time of that phase clamped and not continued
+  if (elapsed / 100 > UINT16_MAX)
+  {
+    memset(&s_heat, 0, sizeof(s_heat));
+    s_heat.profile = settings_get_active_profile();
+    s_heat.mode = RACETIMER_MODE;
+    s_heat.start = snap.heat_start;
+    memcpy(s_heat.phase, snap.heat_phase, sizeof(s_heat.phase));
+    s_heat.phase[s_program->phases[phase].type] = UINT16_MAX;
+    s_heat.paused = snap.heat_paused;
+    s_heat.pauses = snap.pauses;
+    if (snap.state == STATE_PAUSED)
+    {
+      uint32_t paused = s_heat.paused + time(NULL) - snap.pause_start;
+      s_heat.paused = (paused > UINT16_MAX) ? UINT16_MAX : paused;
+    }
+    DEBUG("%s phase %d left for %lu s", __func__, phase, (unsigned long)(elapsed / 1000));
+    history_append(&s_heat);
+    return false;
+  }
+
+  DEBUG("%s phase %d %dms", __func__, phase, (int)elapsed);
+
+  // texts of a stopped heat, with the ended phases at 0
+  racetimer_reset();
+  for (uint8_t i = 0; i < phase; i++)
+  {
+    const settings_phase_t *ended = &s_program->phases[i];
+    if (ended->type == SETTINGS_PHASE_PRE_RACE)
+    {
+      timer_time_str_ms(0, false, ended->resolution, pretime_str,sizeof(pretime_str));
+      clock_layer_set_text(pretimer_layer, pretime_str);
+    }
+    else if (ended->type == SETTINGS_PHASE_RACE)
+    {
+      progress_layer_set_foreground_color(s_progress_layer, PROGRESS_FG_COLOR);
+      progress_layer_set_progress(s_progress_layer, 100);
+    }
+  }
+  racetimer_start_phase(phase);
+
+  s_heat.start = snap.heat_start;
+  memcpy(s_heat.phase, snap.heat_phase, sizeof(s_heat.phase));
+  s_heat.paused = snap.heat_paused;
+  s_heat.pauses = snap.pauses;
+
+  timer_set_elapsed_ms(rctimer, elapsed);
+  if (snap.state == STATE_PAUSED)
+  {
+    timer_pause(rctimer);
+    s_pause_start = snap.pause_start;
+    SetActionBarIcons(ICONS_PAUSED);
+  }
+
+  // the end of a phase passed while the app was closed
+  if (vibe != TIMER_VIBE_NONE)
+  {
+    haptic_request(HAPTIC_EXPIRED, vibe);
+    haptic_flush(racetimer_now_ms());
+  }
+
+  prev_state = STATE_PHASE_RUNNING;
+  state = (snap.state == STATE_PAUSED) ? STATE_PAUSED : STATE_PHASE_RUNNING;
+  return true;
+}
+
+/******************************************************************************
+  State machine actions
+
+  An action gets the next state from the transition table and returns the
+  state to go to, which only differs when the action decides it at runtime.
+******************************************************************************/
+typedef racetimer_state (*racetimer_action)(racetimer_state next, uint8_t clicks);
+
+static racetimer_state action_reset(racetimer_state next, uint8_t clicks)
+{
+  racetimer_reset();
+  return next;
+}
+
+static racetimer_state action_select_profile(racetimer_state next, uint8_t clicks)
+{
+  settings_set_active_profile(clicks);
+  racetimer_reset();
+  return next;
+}
+
+static racetimer_state action_settings(racetimer_state next, uint8_t clicks)
+{
+  settings_push_window(racetimer_setting_cb);
+  return next;
+}
+
+static racetimer_state action_start(racetimer_state next, uint8_t clicks)
+{
+  if(settings_get_mode() == LAPTIMER_MODE)
+  {
+    racetimer_start_lap();
+    return STATE_LAP_RUNNING;
+  }
+  s_program = settings_program();
+  racetimer_start_phase(0);
+  return STATE_PHASE_RUNNING;
+}
+
+static racetimer_state action_pause(racetimer_state next, uint8_t clicks)
+{
+  racetimer_pause();
+  return next;
+}
+
+static racetimer_state action_resume(racetimer_state next, uint8_t clicks)
+{
+  racetimer_resume();
+  return prev_state;
+}
+
+// The heat stops after the last phase
+static racetimer_state action_next_phase(racetimer_state next, uint8_t clicks)
+{
+  if (s_phase_index + 1 >= s_program->num_phases)
+  {
+    racetimer_reset();
+    return STATE_STOPPED;
+  }
+  racetimer_start_phase(s_phase_index + 1);
+  return next;
+}
+
+// Only a phase counting up is ended by hand, a timed one runs to its end
+static racetimer_state action_end_phase(racetimer_state next, uint8_t clicks)
+{
+  if (s_phase->duration || s_phase_index + 1 >= s_program->num_phases)
+    return next;
+  return action_next_phase(next, clicks);
+}
+
+static racetimer_state action_lap(racetimer_state next, uint8_t clicks)
+{
+  racetimer_lap();
+  return next;
 }
 
+/******************************************************************************
+  Transition table, events not listed are ignored in that state
+******************************************************************************/
+#define TRANSITIONS(x)                                                                                 \
+  x(STATE_STOPPED,            EVENT_INIT,           STATE_STOPPED,            action_reset)            \
+  x(STATE_STOPPED,            EVENT_CLICK_UP,       STATE_STOPPED,            action_select_profile)   \
+  x(STATE_STOPPED,            EVENT_CLICK_DOWN,     STATE_PHASE_RUNNING,      action_start)            \
+  x(STATE_STOPPED,            EVENT_CLICK_SELECT,   STATE_STOPPED,            action_settings)         \
+  x(STATE_PHASE_RUNNING,      EVENT_CLICK_UP,       STATE_STOPPED,            action_reset)            \
+  x(STATE_PHASE_RUNNING,      EVENT_CLICK_DOWN,     STATE_PAUSED,             action_pause)            \
+  x(STATE_PHASE_RUNNING,      EVENT_CLICK_SELECT,   STATE_PHASE_RUNNING,      action_end_phase)        \
+  x(STATE_PHASE_RUNNING,      EVENT_TIMER_EXPIRED,  STATE_PHASE_RUNNING,      action_next_phase)       \
+  x(STATE_LAP_RUNNING,        EVENT_CLICK_UP,       STATE_STOPPED,            action_reset)            \
+  x(STATE_LAP_RUNNING,        EVENT_CLICK_DOWN,     STATE_PAUSED,             action_pause)            \
+  x(STATE_LAP_RUNNING,        EVENT_CLICK_SELECT,   STATE_LAP_RUNNING,        action_lap)              \
+  x(STATE_PAUSED,             EVENT_CLICK_UP,       STATE_STOPPED,            action_reset)            \
+  x(STATE_PAUSED,             EVENT_CLICK_DOWN,     STATE_PAUSED,             action_resume)
+
+typedef struct
+{
+  racetimer_state   next;
+  racetimer_action  action;
+}racetimer_transition;
+
+#define GENERATE_TRANSITION(STATE, EVENT, NEXT, ACTION) [STATE][EVENT] = { NEXT, ACTION },
+
+static const racetimer_transition TRANSITION_TABLE[NUM_STATES][NUM_EVENTS] = {
+  TRANSITIONS(GENERATE_TRANSITION)
+};
+
 static void racetimer_event_handler(racetimer_event event)
 {
   racetimer_event_handler_with_clicks(event, 0);
@@ -325,129 +965,38 @@ static void racetimer_event_handler(racetimer_event event)
 static void racetimer_event_handler_with_clicks(racetimer_event event, uint8_t clicks)
 {
   static uint8_t cnt=0;
+  const racetimer_transition *transition = &TRANSITION_TABLE[state][event];
   racetimer_state new_state = state;
 
   DEBUG("%2d STATE      %s", cnt, STATES_STRING[state]);
   DEBUG("%2d PREV_STATE %s", cnt, STATES_STRING[prev_state]);
   DEBUG("%2d EVENT      %s", cnt, EVENTS_STRING[event]);
+  TRACE(TRACE_EVENT, event | clicks << 4);
 
-  switch(state)
+  if (transition->action)
   {
-    case STATE_STOPPED:
-      switch(event)
-      {
-        case EVENT_INIT:
-          racetimer_reset();
-          break;
-        case EVENT_CLICK_UP:
-          settings_set_active_profile(clicks);
-          racetimer_reset();
-          break;
-
-        case EVENT_CLICK_DOWN:
-          if(settings()->pre_race_duration == 0) // No pretimer
-          {
-            new_state = STATE_RACE_RUNNING;
-            racetimer_start_race();
-          }
-          else
-          {
-            new_state = STATE_PRE_RACE_RUNNING;
-            racetimer_start_pre_race();
-          }
-          break;
-        case EVENT_SETTINGS:
-          settings_push_window(racetimer_setting_cb);
-        default:
-          break;
-      }
-      break;
-    case STATE_PRE_RACE_RUNNING:
-      switch(event)
-      {
-        case EVENT_CLICK_UP:
-          // Stop
-          new_state = STATE_STOPPED;
-          racetimer_reset();
-          break;
-        case EVENT_CLICK_DOWN:
-          // pause
-          new_state = STATE_PAUSED;
-          racetimer_pause();
-          break;
-        case EVENT_TIMER_EXPIRED:
-          new_state = STATE_RACE_RUNNING;
-          racetimer_start_race();
-          break;
-        default:
-          break;
-      }
-      break;
-    case STATE_RACE_RUNNING:
-      switch(event)
-      {
-        case EVENT_CLICK_UP:
-          // Stop
-          new_state = STATE_STOPPED;
-          racetimer_reset();
-          break;
-        case EVENT_CLICK_DOWN:
-          // pause
-          new_state = STATE_PAUSED;
-          racetimer_pause();
-          break;
-        case EVENT_TIMER_EXPIRED:
-          new_state = STATE_AFTER_RACE_RUNNING;
-          racetimer_start_after_race();
-          break;
-        default:
-          break;
-      }
-      break;
-    case STATE_AFTER_RACE_RUNNING:
-      switch(event)
-      {
-        case EVENT_CLICK_UP:
-          // Stop
-          new_state = STATE_STOPPED;
-          racetimer_reset();
-          break;
-        case EVENT_CLICK_DOWN:
-          // pause
-          new_state = STATE_PAUSED;
-          racetimer_pause();
-          break;
-        default:
-          break;
-      }
-      break;
-    case STATE_PAUSED:
-      switch(event)
-      {
-        case EVENT_CLICK_UP:
-          // Stop
-          new_state = STATE_STOPPED;
-          racetimer_reset();
-          break;
-        case EVENT_CLICK_DOWN:
-          // resume
-          new_state = prev_state;
-          racetimer_resume();
-          break;
-        default:
-          break;
-      }
-      break;
+    new_state = transition->action(transition->next, clicks);
   }
+
   DEBUG("%2d NEW_STATE  %s",cnt, STATES_STRING[new_state]);
-  prev_state = state;
-  state = new_state;
+  if (new_state != state)
+  {
+    TRACE(TRACE_STATE, new_state);
+    prev_state = state;
+    state = new_state;
+  }
   cnt++;
   cnt = cnt % 100;
 }
 
 static void window_appear(Window *window) {
 //  racetimer_reset();
+  static bool s_first_appear = true;
+  if (s_first_appear)
+  {
+    rctimer_log_startup("race window appear");
+    s_first_appear = false;
+  }
 }
 
 static void window_load(Window *window) {
@@ -469,26 +1018,22 @@ static void window_load(Window *window) {
   text_layer_set_font(title_layer, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD));
   text_layer_set_text(title_layer, "Race Timer");
 
-  pretimer_layer = text_layer_create((GRect){
+  // clocks are drawn from the digit glyph atlas, the layers follow its height
+  int16_t clock_h = clock_layer_get_glyph_height() + 6;
+
+  pretimer_layer = clock_layer_create((GRect){
     .origin = { 6, 50 },
-    .size = { bounds.size.w - ACTION_BAR_WIDTH - 12, 34 }
+    .size = { bounds.size.w - ACTION_BAR_WIDTH - 12, clock_h }
   });
-  text_layer_set_text_alignment(pretimer_layer, GTextAlignmentRight);
-  text_layer_set_font(pretimer_layer, fonts_get_system_font(FONT_KEY_DROID_SERIF_28_BOLD));
-//text_layer_set_background_color(pretimer_layer,GColorGreen);
 
-  timer_layer = text_layer_create((GRect){
-    .origin = { 6, 84 },
-    .size = { bounds.size.w - ACTION_BAR_WIDTH - 12, 34 }
+  timer_layer = clock_layer_create((GRect){
+    .origin = { 6, 50 + clock_h },
+    .size = { bounds.size.w - ACTION_BAR_WIDTH - 12, clock_h }
   });
-//  text_layer_set_font(timer_layer, fonts_load_resource_font(RESOURCE_ID_FONT_FUTURA_CONDENSED_24));
-  text_layer_set_font(timer_layer, fonts_get_system_font(FONT_KEY_DROID_SERIF_28_BOLD));
-  text_layer_set_text_alignment(timer_layer, GTextAlignmentRight);
-//text_layer_set_background_color(timer_layer,GColorYellow);
 
   layer_add_child(window_layer, text_layer_get_layer(title_layer));
-  layer_add_child(window_layer, text_layer_get_layer(pretimer_layer));
-  layer_add_child(window_layer, text_layer_get_layer(timer_layer));
+  layer_add_child(window_layer, pretimer_layer);
+  layer_add_child(window_layer, timer_layer);
 
 
   // Initialize the action bar:
@@ -501,9 +1046,8 @@ static void window_load(Window *window) {
   action_bar_layer_set_click_config_provider(action_bar,
                                              click_config_provider);
 
-  s_icon_stop = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_STOP);
+  // stop and pause icons are loaded when a race is started
   s_icon_start = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_PLAY);
-  s_icon_pause = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_PAUSE);
   s_icon_settings = bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_SETTINGS);
 
   // Status bar
@@ -512,10 +1056,10 @@ static void window_load(Window *window) {
 // Progressbar
   s_progress_layer = progress_layer_create((GRect){
 #if defined(PBL_ROUND)
-    .origin = { 18, 124 },
+    .origin = { 18, 56 + 2 * clock_h },
     .size = { bounds.size.w - ACTION_BAR_WIDTH - 24, 10 }
 #else
-    .origin = { 6, 124 },
+    .origin = { 6, 56 + 2 * clock_h },
     .size = { bounds.size.w - ACTION_BAR_WIDTH - 12, 20 }
 #endif
     });
@@ -527,16 +1071,24 @@ static void window_load(Window *window) {
 
   rctimer = timer_create();
 
-  racetimer_event_handler(EVENT_INIT);
+  racetimer_worker_stop();
+  if (!racetimer_snapshot_restore())
+  {
+    racetimer_event_handler(EVENT_INIT);
+  }
   HEAP_CHECK_STOP();
 }
 
 static void window_unload(Window *window) {
   HEAP_CHECK_START();
+  racetimer_queue_reset();
+  racetimer_worker_handover();
+  racetimer_snapshot_save();
+  racetimer_heat_end();
   deinit_statusbar();
   text_layer_destroy(title_layer);
-  text_layer_destroy(pretimer_layer);
-  text_layer_destroy(timer_layer);
+  clock_layer_destroy(pretimer_layer);
+  clock_layer_destroy(timer_layer);
   timer_destroy(rctimer);
   action_bar_layer_remove_from_window(action_bar);
   action_bar_layer_destroy(action_bar);
@@ -2,3 +2,6 @@
 
 void racetimer_init(void);
 void racetimer_deinit(void);
+
+// Debug
+uint32_t racetimer_debug_redraws(void);
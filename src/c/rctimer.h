@@ -1,3 +1,6 @@
 #pragma once
 #define RCTIMER_VERSION "1.30"
 
+// Log the time since the app was launched
+void rctimer_log_startup(const char *what);
+
@@ -1,13 +1,17 @@
 #include <pebble.h>
 #include <utils/pebble-assist.h>
+#include "../log.h"
 #include <utils/bitmap-loader.h>
 #include "../rctimer.h"
 #include "../icons.h"
 #include "../about.h"
 #include "settings.h"
 #include "win-duration.h"
-
-#define NUM_OF_PROFILES 5
+#include "win-profiles.h"
+#include "win-name.h"
+#include "win-program.h"
+#include "../history/win-history.h"
+#include "../perf/perf.h"
 
 #define TXT_SETTINGS            "Settings"
 #define TXT_DURATION            "Duration"
@@ -18,13 +22,24 @@
 #define TXT_WARNING             "Warning"
 #define TXT_EOR                 "End Of Race"
 #define TXT_EOR_VIBE            (TXT_EOR" "TXT_VIBE)
+#define TXT_DISPLAY             "Display"
+#define TXT_ALERT               "Alert"
+#define TXT_OFF                 "Off"
+#define TXT_PROGRAM             "Program"
+#define TXT_CLASSIC             "Classic"
+#define TXT_PHASES              "Phases"
 
 #define TXT_PRE_RACE            "Pre Race"
 #define TXT_RACE                "Race"
 #define TXT_AFTER_RACE          "After Race"
 #define TXT_ABOUT               "About rcTimer"
+#define TXT_HISTORY             "History"
+#define TXT_RACE_HISTORY        "Race History"
 
 #define TXT_PROFILE             "Profile"
+#define TXT_MODE                "Mode"
+#define TXT_RACE_TIMER          "Race Timer"
+#define TXT_LAP_TIMER           "Lap Timer"
 #define TXT_SELECT_PROFILE      ("Select "TXT_PROFILE)
 
 #define TXT_PRE_RACE_SETTING    (TXT_PRE_RACE" "TXT_SETTINGS)
@@ -33,59 +48,142 @@
 #define TXT_ABOUT               "About rcTimer"
 
 // Sections setup
-#define NUM_MENU_SECTIONS         5
+#define NUM_MENU_SECTIONS         6
 #define MENU_SECTION_PROFILE      0
 #define MENU_SECTION_PRE_RACE     1
 #define MENU_SECTION_RACE         2
 #define MENU_SECTION_AFTER_RACE   3
-#define MENU_SECTION_ABOUT        4
+#define MENU_SECTION_HISTORY      4
+#define MENU_SECTION_ABOUT        5
 
 // Profile menu
-#define NUM_SETTINGS_PROFILE          1
+#define NUM_SETTINGS_PROFILE          3
 #define MENU_SETTINGS_PROFILE_SELECT  0
+#define MENU_SETTINGS_PROFILE_MODE    1
+#define MENU_SETTINGS_PROFILE_PROGRAM 2
 
 // Pre Race Settings menu
-#define NUM_SETTINGS_PRE_RACE_ITEMS     3
+#define NUM_SETTINGS_PRE_RACE_ITEMS     4
 #define MENU_SETTINGS_PRE_RACE_DURATION 0
 #define MENU_SETTINGS_PRE_RACE_INTERVAL 1
 #define MENU_SETTINGS_PRE_RACE_END_VIBE 2
+#define MENU_SETTINGS_PRE_RACE_DISPLAY  3
 
 // Race Settings menu
-#define NUM_SETTINGS_RACE_ITEMS       4
+#define NUM_SETTINGS_RACE_ITEMS       (5 + SETTINGS_MAX_ALERTS)
 #define MENU_SETTINGS_RACE_DURATION   0
 #define MENU_SETTINGS_RACE_INTERVAL   1
 #define MENU_SETTINGS_RACE_OVER_WARN  2
 #define MENU_SETTINGS_RACE_OVER_VIBE  3
+#define MENU_SETTINGS_RACE_DISPLAY    4
+#define MENU_SETTINGS_RACE_ALERT      5   // first of SETTINGS_MAX_ALERTS rows
 
 // After Race Settings menu
-#define NUM_SETTINGS_AFTER_RACE_ITEMS     1
+#define NUM_SETTINGS_AFTER_RACE_ITEMS     2
 #define MENU_SETTINGS_AFTER_RACE_INTERVAL 0
+#define MENU_SETTINGS_AFTER_RACE_DISPLAY  1
+
+// History
+#define NUM_SETTINGS_HISTORY_ITEMS    1
+#define MENU_SETTINGS_HISTORY_HEATS   0
 
 // About Settings
 #define NUM_SETTINGS_ABOUT_ITEMS      2
 #define MENU_SETTINGS_ABOUT_VERSION   0
 #define MENU_SETTINGS_ABOUT_CREDITS   1
+#define MENU_SETTINGS_ABOUT_PERF      2   // hidden, long select on the version shows it
+
+// Row cache, the rows of the setting sections one after the other, 18 rows
+// of 3 profile, 4 pre race, 9 race and 2 after race rows
+#define MENU_CACHE_PROFILE            0
+#define MENU_CACHE_PRE_RACE           (MENU_CACHE_PROFILE + NUM_SETTINGS_PROFILE)
+#define MENU_CACHE_RACE               (MENU_CACHE_PRE_RACE + NUM_SETTINGS_PRE_RACE_ITEMS)
+#define MENU_CACHE_AFTER_RACE         (MENU_CACHE_RACE + NUM_SETTINGS_RACE_ITEMS)
+#define MENU_CACHE_ROWS               (MENU_CACHE_AFTER_RACE + NUM_SETTINGS_AFTER_RACE_ITEMS)
+#define MENU_CACHE_STR_SIZE           12    // "255 Phases"
 
 
 static Window *window;
 static MenuLayer *s_menu_layer;
+
+#if PERF_PROBES
+static bool s_show_perf = false;
+static uint8_t s_perf_probe = 0;
+#endif
 static SettingsCallback s_callback;
 
+// race alert point being edited
+static uint8_t s_alert_edit = 0;
+
+static const char *ALERT_TITLES[SETTINGS_MAX_ALERTS] = {
+  TXT_ALERT" 1", TXT_ALERT" 2", TXT_ALERT" 3", TXT_ALERT" 4"
+};
+
+// formatted row subtitles, the ones not formatted point to constant strings
+static char s_row_str[MENU_CACHE_ROWS][MENU_CACHE_STR_SIZE];
+static char s_row_profile[SETTINGS_NAME_LEN];
+static const char *s_row_sub[MENU_CACHE_ROWS];
+static bool s_row_valid = false;
+
 static void pre_race_duration_callback(uint32_t duration);
 static void pre_race_interval_callback(uint32_t duration);
 
 static void race_duration_callback(uint32_t duration);
 static void race_interval_callback(uint32_t duration);
 static void race_over_warn_callback(uint32_t duration);
+static void race_alert_callback(uint32_t duration);
 
 static void after_race_interval_callback(uint32_t duration);
 
 // Storage
+
+// Profile index, the order of the profiles and the id of the key each one is
+// stored under. Only the active profile is held in memory, the memory used
+// does not grow with the number of profiles.
+typedef struct __attribute__((__packed__)) {
+    uint8_t     count;
+    uint8_t     ids[SETTINGS_MAX_PROFILES];
+} settings_index_t;
+
+static settings_index_t s_index;
+static uint8_t s_active = 0;            // position in the index
+static settings_t s_settings;           // the active profile
+static rctimer_mode_t s_mode = RACETIMER_MODE;
+
+// changed since the last save
+static bool s_dirty = false;
+static bool s_dirty_index = false;
+static bool s_dirty_active = false;
+static bool s_dirty_mode = false;
+
+// program of the active profile as run, compiled when first asked for after
+// a change so starting a heat does not check the phases again
+static settings_program_t s_program;
+static bool s_program_valid = false;
+
+// Names of the profiles listed last, by id, so the profile list does not
+// read the storage on every draw
+#define NAME_CACHE_SIZE 8
+#define NAME_CACHE_NONE SETTINGS_MAX_PROFILES
+
+typedef struct {
+    uint8_t     id;
+    char        name[SETTINGS_NAME_LEN];
+} settings_name_t;
+
+static settings_name_t s_names[NAME_CACHE_SIZE];
+
+// V2 storage, before display resolution was added
 typedef struct{
-    uint8_t     active;
-    settings_t  settings[NUM_OF_PROFILES];
-} profile_setting_t;
-profile_setting_t profile;
+    uint8_t       active;
+    settings_v2_t settings[SETTINGS_LEGACY_PROFILES];
+} profile_setting_v2_t;
+
+// V3 storage, all profiles in one blob
+typedef struct{
+    uint8_t       active;
+    settings_v3_t settings[SETTINGS_LEGACY_PROFILES];
+} profile_setting_v3_t;
 
 HEAP_CHECK;
 
@@ -101,27 +199,313 @@ static void settings_set_default(settings_t *setting) {
     .race_over_warning      = 15,
     .race_over_vibe         = TIMER_VIBE_TRIPLE,
 
-    .after_race_interval    = 60
+    .after_race_interval    = 60,
+
+    .pre_race_resolution    = TIMER_RES_TENTH,
+    .race_resolution        = TIMER_RES_TENTH,
+    .after_race_resolution  = TIMER_RES_SECOND,
+
+    .race_alerts            = { 0 },
+    .name                   = "",
+    .program                = { .num_phases = 0 }
   };
 }
 
-static void settings_default_all(void)
+// The profiles of the formats before V6, under ids 0 to 4
+static void settings_index_legacy(void)
 {
-  profile.active = 0;
-  DEBUG("Default all Settings");
+  s_index.count = SETTINGS_LEGACY_PROFILES;
+  for (uint8_t i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+  {
+    s_index.ids[i] = i;
+  }
+}
 
-  settings_set_default(&profile.settings[0]);
-  settings_set_default(&profile.settings[1]);
-  settings_set_default(&profile.settings[2]);
-  settings_set_default(&profile.settings[3]);
-  settings_set_default(&profile.settings[4]);
+static void settings_name_cache_reset(void)
+{
+  for (uint8_t i = 0; i < NAME_CACHE_SIZE; i++)
+  {
+    s_names[i].id = NAME_CACHE_NONE;
+  }
 }
 
-static void settings_save(void) {
-  DEBUG("Save Settings");
-  if (0 > persist_write_data(SETTINGS_KEY, &profile, sizeof(profile_setting_t))) {
+/******************************************************************************
+  Storage
+
+  Each profile is stored packed under its own key, so a change only writes
+  the active profile. The index key holds the order of the profiles.
+******************************************************************************/
+static void settings_pack(const settings_t *setting, settings_packed_t *packed)
+{
+  *packed = (settings_packed_t) {
+    .pre_race_duration    = setting->pre_race_duration,
+    .pre_race_interval    = setting->pre_race_interval,
+    .race_duration        = setting->race_duration,
+    .race_interval        = setting->race_interval,
+    .race_over_warning    = setting->race_over_warning,
+    .after_race_interval  = setting->after_race_interval,
+    .vibes                = setting->pre_race_over_vibe | (setting->race_over_vibe << 4),
+    .resolution           = setting->pre_race_resolution |
+                            (setting->race_resolution << 1) |
+                            (setting->after_race_resolution << 2),
+  };
+  memcpy(packed->race_alerts, setting->race_alerts, sizeof(packed->race_alerts));
+  memcpy(packed->name, setting->name, sizeof(packed->name));
+  // the phase count and the phases used, the rest of the program stays zero
+  packed->program.num_phases = setting->program.num_phases;
+  memcpy(packed->program.phases, setting->program.phases,
+         setting->program.num_phases * sizeof(settings_phase_t));
+}
+
+static void settings_unpack(const settings_packed_t *packed, settings_t *setting)
+{
+  setting->pre_race_duration = packed->pre_race_duration;
+  setting->pre_race_interval = packed->pre_race_interval;
+  setting->race_duration = packed->race_duration;
+  setting->race_interval = packed->race_interval;
+  setting->race_over_warning = packed->race_over_warning;
+  setting->after_race_interval = packed->after_race_interval;
+  setting->pre_race_over_vibe = (packed->vibes & 0x0F) % TIMER_VIBE_MAX;
+  setting->race_over_vibe = (packed->vibes >> 4) % TIMER_VIBE_MAX;
+  setting->pre_race_resolution = (packed->resolution & 0x01);
+  setting->race_resolution = (packed->resolution >> 1) & 0x01;
+  setting->after_race_resolution = (packed->resolution >> 2) & 0x01;
+  memcpy(setting->race_alerts, packed->race_alerts, sizeof(setting->race_alerts));
+  memcpy(setting->name, packed->name, sizeof(setting->name));
+  setting->name[SETTINGS_NAME_LEN - 1] = '\0';
+  memset(&setting->program, 0, sizeof(setting->program));
+  setting->program.num_phases = packed->program.num_phases;
+  if (setting->program.num_phases > SETTINGS_MAX_PHASES)
+    setting->program.num_phases = SETTINGS_MAX_PHASES;
+  memcpy(setting->program.phases, packed->program.phases,
+         setting->program.num_phases * sizeof(settings_phase_t));
+}
+
+// A V4 to V6 profile is shorter, the fields appended since keep their default
+static bool settings_read_packed(uint8_t id, settings_packed_t *packed)
+{
+  memset(packed, 0, sizeof(settings_packed_t));
+  PERF_START(PERF_PERSIST);
+  int read = persist_read_data(SETTINGS_PROFILE_KEY + id, packed, sizeof(settings_packed_t));
+  PERF_STOP(PERF_PERSIST);
+  return 0 < read;
+}
+
+static void settings_store(uint8_t id, const settings_t *setting)
+{
+  settings_packed_t packed;
+
+  settings_pack(setting, &packed);
+  PERF_START(PERF_PERSIST);
+  if (0 > persist_write_data(SETTINGS_PROFILE_KEY + id, &packed, SETTINGS_PACKED_SIZE(packed.program.num_phases))) {
     LOG("Settings save failed");
   }
+  PERF_STOP(PERF_PERSIST);
+  s_names[id % NAME_CACHE_SIZE].id = NAME_CACHE_NONE;
+}
+
+// A profile is counted against SETTINGS_STORE_SIZE at least at the size of
+// the classic program, which a classic profile gets when it is edited
+static uint16_t settings_store_size(uint8_t num_phases)
+{
+  if (num_phases < SETTINGS_CLASSIC_PHASES)
+    num_phases = SETTINGS_CLASSIC_PHASES;
+  return SETTINGS_PACKED_SIZE(num_phases);
+}
+
+// Bytes the stored profiles and their index take
+static uint16_t settings_store_used(void)
+{
+  uint16_t used = 1 + s_index.count;
+
+  for (uint8_t i = 0; i < s_index.count; i++)
+  {
+    int size = persist_get_size(SETTINGS_PROFILE_KEY + s_index.ids[i]);
+    used += (size > settings_store_size(0)) ? size : settings_store_size(0);
+  }
+  return used;
+}
+
+static void settings_cache_invalidate(void);
+static void settings_program_compile(void);
+
+static void settings_mark_dirty(void)
+{
+  s_dirty = true;
+  s_program_valid = false;
+  settings_cache_invalidate();
+}
+
+static void settings_mark_all_dirty(void)
+{
+  s_dirty = true;
+  s_dirty_index = true;
+  s_dirty_active = true;
+  s_dirty_mode = true;
+}
+
+// A changed profile is compiled when saved, a heat started after it does
+// not check its phases
+static void settings_save(void) {
+  DEBUG("Save Settings %d", (int)s_dirty);
+  if (s_dirty)
+  {
+    settings_store(s_index.ids[s_active], &s_settings);
+    if (!s_program_valid)
+      settings_program_compile();
+  }
+  if (s_dirty_index)
+    persist_write_data(SETTINGS_INDEX_KEY, &s_index, 1 + s_index.count);
+  if (s_dirty_active)
+    persist_write_int(SETTINGS_ACTIVE_KEY, s_active);
+  if (s_dirty_mode)
+    persist_write_int(SETTINGS_MODE_KEY, s_mode);
+
+  s_dirty = false;
+  s_dirty_index = false;
+  s_dirty_active = false;
+  s_dirty_mode = false;
+}
+
+static void settings_load_profile(uint8_t pos)
+{
+  settings_packed_t packed;
+
+  if (settings_read_packed(s_index.ids[pos], &packed))
+  {
+    settings_unpack(&packed, &s_settings);
+  }
+  else
+  {
+    settings_set_default(&s_settings);
+  }
+  s_active = pos;
+  settings_program_compile();
+}
+
+// A stored index is trusted no further than its ids: those out of range,
+// which would reach the keys after the profiles, and repeated ones are
+// dropped. With none left there is one profile, the default.
+static void settings_load_index(void)
+{
+  bool used[SETTINGS_MAX_PROFILES] = { false };
+  int read;
+  uint8_t count = 0;
+
+  memset(&s_index, 0, sizeof(s_index));
+  read = persist_read_data(SETTINGS_INDEX_KEY, &s_index, sizeof(s_index));
+  if (0 >= read)
+  {
+    settings_index_legacy();
+    return;
+  }
+
+  if (s_index.count > read - 1)
+    s_index.count = read - 1;
+  for (uint8_t i = 0; i < s_index.count; i++)
+  {
+    uint8_t id = s_index.ids[i];
+    if (id < SETTINGS_MAX_PROFILES && !used[id])
+    {
+      used[id] = true;
+      s_index.ids[count++] = id;
+    }
+  }
+  if (count != s_index.count || count == 0)
+  {
+    WARN("Profile index %d of %d ids valid", count, s_index.count);
+    s_dirty_index = true;
+  }
+  s_index.count = count;
+  if (0 == s_index.count)
+    s_index.ids[s_index.count++] = 0;
+}
+
+static void settings_load_v3(void)
+{
+  profile_setting_v3_t *v3 = malloc(sizeof(profile_setting_v3_t));
+
+  if (v3 && 0 < persist_read_data(SETTINGS_KEY, v3, sizeof(profile_setting_v3_t)))
+  {
+    DEBUG("Copy V3 Settings");
+
+    s_active = v3->active % SETTINGS_LEGACY_PROFILES;
+    for (int i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+    {
+      settings_t p;
+      settings_v3_t *o = &v3->settings[i];
+      settings_set_default(&p);
+      p.pre_race_duration = o->pre_race_duration;
+      p.pre_race_interval = o->pre_race_interval;
+      p.pre_race_over_vibe = o->pre_race_over_vibe;
+      p.race_duration = o->race_duration;
+      p.race_interval = o->race_interval;
+      p.race_over_warning = o->race_over_warning;
+      p.race_over_vibe = o->race_over_vibe;
+      p.after_race_interval = o->after_race_interval;
+      p.pre_race_resolution = o->pre_race_resolution;
+      p.race_resolution = o->race_resolution;
+      p.after_race_resolution = o->after_race_resolution;
+      settings_store(i, &p);
+    }
+  }
+  free(v3);
+}
+
+static void settings_load_v2(void)
+{
+  profile_setting_v2_t *v2 = malloc(sizeof(profile_setting_v2_t));
+
+  if (v2 && 0 < persist_read_data(SETTINGS_KEY, v2, sizeof(profile_setting_v2_t)))
+  {
+    DEBUG("Copy V2 Settings");
+
+    // copy from V2 format, the display resolution keeps its default
+    s_active = v2->active % SETTINGS_LEGACY_PROFILES;
+    for (int i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+    {
+      settings_t p;
+      settings_v2_t *o = &v2->settings[i];
+      settings_set_default(&p);
+      p.pre_race_duration = o->pre_race_duration;
+      p.pre_race_interval = o->pre_race_interval;
+      p.pre_race_over_vibe = o->pre_race_over_vibe;
+      p.race_duration = o->race_duration;
+      p.race_interval = o->race_interval;
+      p.race_over_warning = o->race_over_warning;
+      p.race_over_vibe = o->race_over_vibe;
+      p.after_race_interval = o->after_race_interval;
+      settings_store(i, &p);
+    }
+  }
+  free(v2);
+}
+
+static void settings_load_old(void)
+{
+  old_settings_t old_settings;
+
+  if (0 < persist_read_data(OLD_SETTINGS_KEY, &old_settings, sizeof(old_settings_t)))
+  {
+    // old setting exists!
+
+    settings_t p;
+
+    DEBUG("Copy old Settings");
+
+    // copy from old to new format into profile1
+    s_active = 0;
+    settings_set_default(&p);
+    p.pre_race_duration = old_settings.pre_race_duration;
+    p.pre_race_interval = old_settings.pre_race_interval;
+    p.pre_race_over_vibe = old_settings.pre_race_end_vibe;
+    p.race_duration = old_settings.race_duration;
+    p.race_interval = old_settings.race_interval;
+    p.race_over_warning = old_settings.race_eor_warning;
+    p.race_over_vibe = old_settings.race_end_vibe;
+    p.after_race_interval = old_settings.after_race_interval;
+    settings_store(0, &p);
+  }
 }
 
 static void settings_load(void) {
@@ -129,48 +513,185 @@ static void settings_load(void) {
 
   DEBUG("LOAD Settings: %d", current_version);
 
-  if (SETTINGS_VERSION_CURRENT == current_version)
+  s_mode = (LAPTIMER_MODE == persist_read_int(SETTINGS_MODE_KEY)) ? LAPTIMER_MODE : RACETIMER_MODE;
+  settings_name_cache_reset();
+
+  if (SETTINGS_VERSION_CURRENT == current_version || SETTINGS_VERSION_6 == current_version)
   {
     DEBUG("LOAD Settings");
-    if (0 > persist_read_data(SETTINGS_KEY,&profile, sizeof(profile_setting_t)))
-    {
-      settings_default_all();
-    }
+    // only the index and the active profile, the others are loaded when selected
+    settings_load_index();
+    settings_load_profile(persist_read_int(SETTINGS_ACTIVE_KEY) % s_index.count);
+    // V6 profiles read without a program until they are written again
+    if (SETTINGS_VERSION_6 == current_version)
+      persist_write_int(SETTINGS_VERSION_KEY, SETTINGS_VERSION_CURRENT);
+    return;
   }
-  else if (SETTINGS_VERSION_OLD_0 == current_version)
+
+  // five profiles, copy what the old format has
+  settings_index_legacy();
+  s_active = 0;
+  switch (current_version)
   {
-    old_settings_t old_settings;
+    case SETTINGS_VERSION_5:
+    case SETTINGS_VERSION_4:
+      // same keys, the profiles are read as they are
+      s_active = persist_read_int(SETTINGS_ACTIVE_KEY) % SETTINGS_LEGACY_PROFILES;
+      break;
+    case SETTINGS_VERSION_3:
+      settings_load_v3();
+      break;
+    case SETTINGS_VERSION_2:
+      settings_load_v2();
+      break;
+    case SETTINGS_VERSION_OLD_0:
+      settings_load_old();
+      break;
+    default:
+      break;
+  }
+  settings_load_profile(s_active);
 
-    // set all default and update version
-    settings_default_all();
-    persist_write_int(SETTINGS_VERSION_KEY, SETTINGS_VERSION_CURRENT);
+  // write the current format and drop the old one
+  settings_mark_all_dirty();
+  settings_save();
+  persist_write_int(SETTINGS_VERSION_KEY, SETTINGS_VERSION_CURRENT);
+  persist_delete(SETTINGS_KEY);
+  persist_delete(OLD_SETTINGS_KEY);
+}
+
+settings_t* settings() {
+  return &s_settings;
+}
+
+/******************************************************************************
+  Program
+
+  A profile without phases runs its pre race, race and after race settings
+  as a program of up to three phases. The phases are checked when compiled,
+  the race timer takes them as they are.
+******************************************************************************/
+static void settings_program_classic(const settings_t *setting, settings_program_t *program)
+{
+  uint8_t n = 0;
+
+  memset(program, 0, sizeof(settings_program_t));
+  if (setting->pre_race_duration)
+  {
+    program->phases[n++] = (settings_phase_t) {
+      .type       = SETTINGS_PHASE_PRE_RACE,
+      .end_vibe   = setting->pre_race_over_vibe,
+      .resolution = setting->pre_race_resolution,
+      .duration   = setting->pre_race_duration,
+      .interval   = setting->pre_race_interval,
+    };
+  }
+  program->phases[n] = (settings_phase_t) {
+    .type       = SETTINGS_PHASE_RACE,
+    .end_vibe   = setting->race_over_vibe,
+    .resolution = setting->race_resolution,
+    .duration   = setting->race_duration,
+    .interval   = setting->race_interval,
+    .warning    = setting->race_over_warning,
+  };
+  memcpy(program->phases[n++].alerts, setting->race_alerts, sizeof(setting->race_alerts));
+  program->phases[n++] = (settings_phase_t) {
+    .type       = SETTINGS_PHASE_AFTER_RACE,
+    .end_vibe   = TIMER_VIBE_NONE,
+    .resolution = setting->after_race_resolution,
+    .interval   = setting->after_race_interval,
+  };
+  program->num_phases = n;
+}
 
-    if (0 < persist_read_data(OLD_SETTINGS_KEY, &old_settings, sizeof(old_settings_t)))
+static void settings_program_compile(void)
+{
+  if (0 == s_settings.program.num_phases)
+  {
+    settings_program_classic(&s_settings, &s_program);
+  }
+  else
+  {
+    s_program = s_settings.program;
+    for (uint8_t i = 0; i < s_program.num_phases; i++)
     {
-      // old setting exists!
-
-      settings_t *p;
-
-      DEBUG("Copy old Settings");
-      persist_delete(OLD_SETTINGS_KEY);
-
-      // copy from old to new format into profile1
-      profile.active = 0;
-      p = &profile.settings[profile.active];
-      p->pre_race_duration = old_settings.pre_race_duration;
-      p->pre_race_interval = old_settings.pre_race_interval;
-      p->pre_race_over_vibe = old_settings.pre_race_end_vibe;
-      p->race_duration = old_settings.race_duration;
-      p->race_interval = old_settings.race_interval;
-      p->race_over_warning = old_settings.race_eor_warning;
-      p->race_over_vibe = old_settings.race_end_vibe;
-      p->after_race_interval = old_settings.after_race_interval;
+      settings_phase_t *phase = &s_program.phases[i];
+      phase->type %= SETTINGS_NUM_PHASE_TYPES;
+      phase->end_vibe %= TIMER_VIBE_MAX;
+      phase->resolution %= TIMER_RES_MAX;
+      if (phase->duration && phase->warning > phase->duration)
+        phase->warning = phase->duration;
     }
   }
+  s_program_valid = true;
 }
 
-settings_t* settings() {
-  return &profile.settings[profile.active];
+// Compiled at load and save, the program editor also gets the changes not
+// saved yet
+const settings_program_t* settings_program(void)
+{
+  if (!s_program_valid)
+    settings_program_compile();
+  return &s_program;
+}
+
+// The classic program is copied into the profile before its first change
+static void settings_program_own(void)
+{
+  if (0 == s_settings.program.num_phases)
+    settings_program_classic(&s_settings, &s_settings.program);
+}
+
+settings_phase_t* settings_edit_phase(uint8_t index)
+{
+  settings_program_own();
+  settings_mark_dirty();
+  return &s_settings.program.phases[index % s_settings.program.num_phases];
+}
+
+// The new phase is a copy of the last one, if the profile still fits the
+// storage with it
+bool settings_add_phase(void)
+{
+  settings_program_t *program = &s_settings.program;
+  int stored = persist_get_size(SETTINGS_PROFILE_KEY + s_index.ids[s_active]);
+
+  settings_program_own();
+  if (program->num_phases >= SETTINGS_MAX_PHASES)
+    return false;
+
+  if (stored < settings_store_size(0))
+    stored = settings_store_size(0);
+  if (settings_store_used() - stored + settings_store_size(program->num_phases + 1) > SETTINGS_STORE_SIZE)
+  {
+    WARN("Profile storage full");
+    return false;
+  }
+
+  program->phases[program->num_phases] = program->phases[program->num_phases - 1];
+  program->num_phases++;
+  settings_mark_dirty();
+  return true;
+}
+
+bool settings_remove_phase(void)
+{
+  settings_program_own();
+  if (s_settings.program.num_phases <= 1)
+    return false;
+
+  s_settings.program.num_phases--;
+  settings_mark_dirty();
+  return true;
+}
+
+void settings_clear_program(void)
+{
+  if (s_settings.program.num_phases)
+  {
+    s_settings.program.num_phases = 0;
+    settings_mark_dirty();
+  }
 }
 
 static uint16_t menu_get_num_sections_callback(MenuLayer *menu_layer, void *data) {
@@ -182,12 +703,18 @@ static uint16_t menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t secti
     case MENU_SECTION_PROFILE:
       return NUM_SETTINGS_PROFILE;
     case MENU_SECTION_PRE_RACE:
-      return NUM_SETTINGS_PRE_RACE_ITEMS;
+      return settings()->program.num_phases ? 0 : NUM_SETTINGS_PRE_RACE_ITEMS;
     case MENU_SECTION_RACE:
-      return NUM_SETTINGS_RACE_ITEMS;
+      return settings()->program.num_phases ? 0 : NUM_SETTINGS_RACE_ITEMS;
     case MENU_SECTION_AFTER_RACE:
-      return NUM_SETTINGS_AFTER_RACE_ITEMS;
+      return settings()->program.num_phases ? 0 : NUM_SETTINGS_AFTER_RACE_ITEMS;
+    case MENU_SECTION_HISTORY:
+      return NUM_SETTINGS_HISTORY_ITEMS;
     case MENU_SECTION_ABOUT:
+#if PERF_PROBES
+      if (s_show_perf)
+        return NUM_SETTINGS_ABOUT_ITEMS + 1;
+#endif
       return NUM_SETTINGS_ABOUT_ITEMS;
     default:
       return 0;
@@ -195,6 +722,9 @@ static uint16_t menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t secti
 }
 
 static int16_t menu_get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  // the classic sections are hidden while the profile runs its own program
+  if (0 == menu_get_num_rows_callback(menu_layer, section_index, data))
+    return 0;
   return MENU_CELL_BASIC_HEADER_HEIGHT;
 }
 
@@ -217,6 +747,9 @@ static void menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, ui
       // Draw title text in the section header
       menu_cell_basic_header_draw(ctx, cell_layer, TXT_AFTER_RACE_SETTING);
       break;
+    case MENU_SECTION_HISTORY:
+      menu_cell_basic_header_draw(ctx, cell_layer, TXT_HISTORY);
+      break;
     case MENU_SECTION_ABOUT:
       // Draw title text in the section header
       menu_cell_basic_header_draw(ctx, cell_layer, TXT_ABOUT);
@@ -224,8 +757,81 @@ static void menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, ui
   }
 }
 
+/******************************************************************************
+  Row cache
+
+  The subtitles are formatted when the window loads or a value changes, a
+  draw, which happens on every frame of a scroll, only looks them up.
+******************************************************************************/
+static void settings_cache_time(uint8_t row, uint32_t time)
+{
+  timer_time_str(time, s_row_str[row], MENU_CACHE_STR_SIZE);
+  s_row_sub[row] = s_row_str[row];
+}
+
+static void settings_cache_build(void)
+{
+  uint8_t row;
+
+  // profile
+  row = MENU_CACHE_PROFILE;
+  settings_get_profile_name(s_active, s_row_profile, sizeof(s_row_profile));
+  s_row_sub[row + MENU_SETTINGS_PROFILE_SELECT] = s_row_profile;
+  s_row_sub[row + MENU_SETTINGS_PROFILE_MODE] = (s_mode == LAPTIMER_MODE) ? TXT_LAP_TIMER : TXT_RACE_TIMER;
+  if (settings()->program.num_phases)
+  {
+    snprintf(s_row_str[row + MENU_SETTINGS_PROFILE_PROGRAM], MENU_CACHE_STR_SIZE, "%d "TXT_PHASES, settings()->program.num_phases);
+    s_row_sub[row + MENU_SETTINGS_PROFILE_PROGRAM] = s_row_str[row + MENU_SETTINGS_PROFILE_PROGRAM];
+  }
+  else
+  {
+    s_row_sub[row + MENU_SETTINGS_PROFILE_PROGRAM] = TXT_CLASSIC;
+  }
+
+  // pre race
+  row = MENU_CACHE_PRE_RACE;
+  settings_cache_time(row + MENU_SETTINGS_PRE_RACE_DURATION, settings()->pre_race_duration);
+  settings_cache_time(row + MENU_SETTINGS_PRE_RACE_INTERVAL, settings()->pre_race_interval);
+  s_row_sub[row + MENU_SETTINGS_PRE_RACE_END_VIBE] = timer_vibe_str(settings()->pre_race_over_vibe, true);
+  s_row_sub[row + MENU_SETTINGS_PRE_RACE_DISPLAY] = timer_resolution_str(settings()->pre_race_resolution);
+
+  // race
+  row = MENU_CACHE_RACE;
+  settings_cache_time(row + MENU_SETTINGS_RACE_DURATION, settings()->race_duration);
+  settings_cache_time(row + MENU_SETTINGS_RACE_INTERVAL, settings()->race_interval);
+  settings_cache_time(row + MENU_SETTINGS_RACE_OVER_WARN, settings()->race_over_warning);
+  s_row_sub[row + MENU_SETTINGS_RACE_OVER_VIBE] = timer_vibe_str(settings()->race_over_vibe, true);
+  s_row_sub[row + MENU_SETTINGS_RACE_DISPLAY] = timer_resolution_str(settings()->race_resolution);
+  for (uint8_t i = 0; i < SETTINGS_MAX_ALERTS; i++)
+  {
+    if (settings()->race_alerts[i])
+      settings_cache_time(row + MENU_SETTINGS_RACE_ALERT + i, settings()->race_alerts[i]);
+    else
+      s_row_sub[row + MENU_SETTINGS_RACE_ALERT + i] = TXT_OFF;
+  }
+
+  // after race
+  row = MENU_CACHE_AFTER_RACE;
+  settings_cache_time(row + MENU_SETTINGS_AFTER_RACE_INTERVAL, settings()->after_race_interval);
+  s_row_sub[row + MENU_SETTINGS_AFTER_RACE_DISPLAY] = timer_resolution_str(settings()->after_race_resolution);
+
+  s_row_valid = true;
+}
+
+static void settings_cache_invalidate(void)
+{
+  s_row_valid = false;
+}
+
+static const char* settings_cache_get(uint8_t row)
+{
+  if (!s_row_valid)
+    settings_cache_build();
+  return s_row_sub[row];
+}
+
 static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
-  char str[16] = "";
+  PERF_START(PERF_MENU_DRAW);
 
   // Determine which section we're going to draw in
   switch (cell_index->section) {
@@ -234,8 +840,15 @@ static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuI
       if (MENU_SETTINGS_PROFILE_SELECT == cell_index->row)
       {
           // This is a basic menu item with a title and subtitle
-          snprintf(str,sizeof(str),"%s %d",TXT_PROFILE, (int)profile.active + 1);
-          menu_cell_basic_draw(ctx, cell_layer, TXT_PROFILE, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_PROFILE, settings_cache_get(MENU_CACHE_PROFILE + cell_index->row), NULL);
+      }
+      else if (MENU_SETTINGS_PROFILE_MODE == cell_index->row)
+      {
+          menu_cell_basic_draw(ctx, cell_layer, TXT_MODE, settings_cache_get(MENU_CACHE_PROFILE + cell_index->row), NULL);
+      }
+      else if (MENU_SETTINGS_PROFILE_PROGRAM == cell_index->row)
+      {
+          menu_cell_basic_draw(ctx, cell_layer, TXT_PROGRAM, settings_cache_get(MENU_CACHE_PROFILE + cell_index->row), NULL);
       }
       break;
     case MENU_SECTION_PRE_RACE:
@@ -243,17 +856,17 @@ static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuI
       switch (cell_index->row) {
         case MENU_SETTINGS_PRE_RACE_DURATION:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->pre_race_duration, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_DURATION, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_DURATION, settings_cache_get(MENU_CACHE_PRE_RACE + cell_index->row), NULL);
           break;
         case MENU_SETTINGS_PRE_RACE_INTERVAL:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->pre_race_interval, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, settings_cache_get(MENU_CACHE_PRE_RACE + cell_index->row), NULL);
           break;
         case MENU_SETTINGS_PRE_RACE_END_VIBE:       // This is a basic menu item with a title and subtitle
-          snprintf(str,sizeof(str),"%s",timer_vibe_str(settings()->pre_race_over_vibe,true));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_START_RACE_INTERVAL, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_START_RACE_INTERVAL, settings_cache_get(MENU_CACHE_PRE_RACE + cell_index->row), NULL);
+          break;
+        case MENU_SETTINGS_PRE_RACE_DISPLAY:
+          menu_cell_basic_draw(ctx, cell_layer, TXT_DISPLAY, settings_cache_get(MENU_CACHE_PRE_RACE + cell_index->row), NULL);
           break;
       }
       break;
@@ -262,22 +875,24 @@ static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuI
       switch (cell_index->row) {
         case MENU_SETTINGS_RACE_DURATION:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->race_duration, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_DURATION, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_DURATION, settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
           break;
         case MENU_SETTINGS_RACE_INTERVAL:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->race_interval, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
           break;
         case MENU_SETTINGS_RACE_OVER_WARN:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->race_over_warning, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, (TXT_EOR" "TXT_WARNING), str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, (TXT_EOR" "TXT_WARNING), settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
           break;
         case MENU_SETTINGS_RACE_OVER_VIBE:       // This is a basic menu item with a title and subtitle
-          snprintf(str,sizeof(str),"%s",timer_vibe_str(settings()->race_over_vibe,true));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_EOR_VIBE, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_EOR_VIBE, settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
+          break;
+        case MENU_SETTINGS_RACE_DISPLAY:
+          menu_cell_basic_draw(ctx, cell_layer, TXT_DISPLAY, settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
+          break;
+        default:
+          menu_cell_basic_draw(ctx, cell_layer, ALERT_TITLES[cell_index->row - MENU_SETTINGS_RACE_ALERT], settings_cache_get(MENU_CACHE_RACE + cell_index->row), NULL);
           break;
       }
       break;
@@ -286,11 +901,16 @@ static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuI
       switch (cell_index->row) {
         case MENU_SETTINGS_AFTER_RACE_INTERVAL:
           // This is a basic menu item with a title and subtitle
-          timer_time_str(settings()->after_race_interval, str, sizeof(str));
-          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, str, NULL);
+          menu_cell_basic_draw(ctx, cell_layer, TXT_VIBE_INTERVAL, settings_cache_get(MENU_CACHE_AFTER_RACE + cell_index->row), NULL);
+          break;
+        case MENU_SETTINGS_AFTER_RACE_DISPLAY:
+          menu_cell_basic_draw(ctx, cell_layer, TXT_DISPLAY, settings_cache_get(MENU_CACHE_AFTER_RACE + cell_index->row), NULL);
           break;
       }
       break;
+    case MENU_SECTION_HISTORY:
+      menu_cell_title_draw(ctx, cell_layer, TXT_RACE_HISTORY);
+      break;
     case MENU_SECTION_ABOUT:
       // Use the row to specify which item we'll draw
       switch (cell_index->row) {
@@ -300,16 +920,37 @@ static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuI
         case MENU_SETTINGS_ABOUT_CREDITS:
           menu_cell_title_draw(ctx, cell_layer, "Credits");
           break;
+#if PERF_PROBES
+        case MENU_SETTINGS_ABOUT_PERF: {
+          char perf[32];
+          perf_str(s_perf_probe, perf, sizeof(perf));
+          menu_cell_basic_draw(ctx, cell_layer, perf_name(s_perf_probe), perf, NULL);
+          break;
+        }
+#endif
       }
       break;
   }
+  PERF_STOP(PERF_MENU_DRAW);
 }
 
 static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
   // Use the row to specify which item will receive the select action
   switch (cell_index->section) {
     case MENU_SECTION_PROFILE:
-      profile.active = (profile.active + 1) % NUM_OF_PROFILES;
+      switch (cell_index->row) {
+        case MENU_SETTINGS_PROFILE_SELECT:
+          win_profiles_show();
+          break;
+        case MENU_SETTINGS_PROFILE_MODE:
+          s_mode = (s_mode == LAPTIMER_MODE) ? RACETIMER_MODE : LAPTIMER_MODE;
+          s_dirty_mode = true;
+          break;
+        case MENU_SETTINGS_PROFILE_PROGRAM:
+          win_program_show();
+          break;
+      }
+      settings_cache_invalidate();
       // After changing the item, mark the layer to have it updated
       layer_mark_dirty(menu_layer_get_layer(menu_layer));
       break;
@@ -323,9 +964,15 @@ static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, v
           break;
         case MENU_SETTINGS_PRE_RACE_END_VIBE:
           settings()->pre_race_over_vibe = (settings()->pre_race_over_vibe + 1) % TIMER_VIBE_MAX;
+          settings_mark_dirty();
           // After changing the item, mark the layer to have it updated
           layer_mark_dirty(menu_layer_get_layer(menu_layer));
           break;
+        case MENU_SETTINGS_PRE_RACE_DISPLAY:
+          settings()->pre_race_resolution = (settings()->pre_race_resolution + 1) % TIMER_RES_MAX;
+          settings_mark_dirty();
+          layer_mark_dirty(menu_layer_get_layer(menu_layer));
+          break;
       }
       break;
     case MENU_SECTION_RACE:
@@ -341,9 +988,20 @@ static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, v
           break;
         case MENU_SETTINGS_RACE_OVER_VIBE:
           settings()->race_over_vibe = (settings()->race_over_vibe + 1) % TIMER_VIBE_MAX;
+          settings_mark_dirty();
           // After changing the item, mark the layer to have it updated
           layer_mark_dirty(menu_layer_get_layer(menu_layer));
           break;
+        case MENU_SETTINGS_RACE_DISPLAY:
+          settings()->race_resolution = (settings()->race_resolution + 1) % TIMER_RES_MAX;
+          settings_mark_dirty();
+          layer_mark_dirty(menu_layer_get_layer(menu_layer));
+          break;
+        default:
+          // remaining race time to vibrate at, 0 turns the alert off
+          s_alert_edit = cell_index->row - MENU_SETTINGS_RACE_ALERT;
+          win_duration_show(settings()->race_alerts[s_alert_edit], race_alert_callback, true, (TXT_RACE" "TXT_ALERT));
+          break;
       }
       break;
     case MENU_SECTION_AFTER_RACE:
@@ -351,18 +1009,44 @@ static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, v
         case MENU_SETTINGS_AFTER_RACE_INTERVAL:
           win_duration_show(settings()->after_race_interval, after_race_interval_callback, true, (TXT_AFTER_RACE" "TXT_VIBE_INTERVAL));
           break;
+        case MENU_SETTINGS_AFTER_RACE_DISPLAY:
+          settings()->after_race_resolution = (settings()->after_race_resolution + 1) % TIMER_RES_MAX;
+          settings_mark_dirty();
+          layer_mark_dirty(menu_layer_get_layer(menu_layer));
+          break;
       }
       break;
+    case MENU_SECTION_HISTORY:
+      win_history_show();
+      break;
     case MENU_SECTION_ABOUT:
       switch (cell_index->row) {
         case MENU_SETTINGS_ABOUT_CREDITS:
           about_window_push();
           break;
+#if PERF_PROBES
+        case MENU_SETTINGS_ABOUT_PERF:
+          // next probe, all of them go to the log
+          s_perf_probe = (s_perf_probe + 1) % PERF_NUM_PROBES;
+          perf_dump();
+          layer_mark_dirty(menu_layer_get_layer(menu_layer));
+          break;
+#endif
       }
       break;
   }
 }
 
+#if PERF_PROBES
+static void menu_select_long_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
+  if (cell_index->section == MENU_SECTION_ABOUT && cell_index->row == MENU_SETTINGS_ABOUT_VERSION)
+  {
+    s_show_perf = !s_show_perf;
+    menu_layer_reload_data(menu_layer);
+  }
+}
+#endif
+
 
 //  window_stack_pop(true);
 static void window_load(Window *window) {
@@ -371,6 +1055,9 @@ static void window_load(Window *window) {
   Layer *window_layer = window_get_root_layer(window);
   GRect bounds = layer_get_frame(window_layer);
 
+  // the profile may have changed since the last time
+  settings_cache_invalidate();
+
   // Create the menu layer
   s_menu_layer = menu_layer_create(bounds);
   menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks){
@@ -380,6 +1067,9 @@ static void window_load(Window *window) {
     .draw_header = menu_draw_header_callback,
     .draw_row = menu_draw_row_callback,
     .select_click = menu_select_callback,
+#if PERF_PROBES
+    .select_long_click = menu_select_long_callback,
+#endif
   });
 
   // Bind the menu layer's click config provider to the window for interactivity
@@ -390,28 +1080,185 @@ static void window_load(Window *window) {
   layer_add_child(window_layer, menu_layer_get_layer(s_menu_layer));
 }
 
+// Back from the profile list or the program editor, the rows shown may differ
+static void window_appear(Window *window) {
+  menu_layer_reload_data(s_menu_layer);
+}
+
 static void window_unload(Window *window) {
   // Destroy the menu layer
   menu_layer_destroy(s_menu_layer);
+  settings_save();
   if (s_callback)
     s_callback();
 }
 
 
+/******************************************************************************
+  Profiles, by their position in the list
+******************************************************************************/
 uint8_t settings_get_num_of_profiles(void)
 {
-  return NUM_OF_PROFILES;
+  return s_index.count;
 }
 
 void settings_set_active_profile(uint8_t id){
-  profile.active = id % NUM_OF_PROFILES;
+  if (s_active != id % s_index.count)
+  {
+    // the profile left is written before the new one is read
+    settings_save();
+    settings_load_profile(id % s_index.count);
+    s_dirty_active = true;
+    settings_cache_invalidate();
+  }
 }
 
 uint8_t settings_get_active_profile(void){
-  return profile.active;
+  return s_active;
+}
+
+// The id stays with the profile when the ones before it are deleted
+uint8_t settings_get_active_profile_id(void)
+{
+  return s_index.ids[s_active];
+}
+
+// A copy of the active profile is added and made active, if there is an id
+// and storage left for it
+bool settings_add_profile(void)
+{
+  bool used[SETTINGS_MAX_PROFILES] = { false };
+  uint8_t id = 0;
+
+  if (s_index.count >= SETTINGS_MAX_PROFILES)
+    return false;
+
+  settings_save();
+  if (settings_store_used() + 1 + settings_store_size(s_settings.program.num_phases) > SETTINGS_STORE_SIZE)
+  {
+    WARN("Profile storage full");
+    return false;
+  }
+
+  for (uint8_t i = 0; i < s_index.count; i++)
+  {
+    used[s_index.ids[i]] = true;
+  }
+  while (used[id])
+    id++;
+
+  s_settings.name[0] = '\0';
+  s_index.ids[s_index.count] = id;
+  s_active = s_index.count++;
+  settings_mark_all_dirty();
+  settings_save();
+  return true;
+}
+
+bool settings_delete_profile(uint8_t id)
+{
+  if (s_index.count <= 1 || id >= s_index.count)
+    return false;
+
+  persist_delete(SETTINGS_PROFILE_KEY + s_index.ids[id]);
+  s_names[s_index.ids[id] % NAME_CACHE_SIZE].id = NAME_CACHE_NONE;
+  memmove(&s_index.ids[id], &s_index.ids[id + 1], s_index.count - id - 1);
+  s_index.count--;
+
+  if (id < s_active)
+  {
+    s_active--;
+  }
+  else if (id == s_active)
+  {
+    // the active profile is gone, nothing of it is saved
+    s_dirty = false;
+    settings_load_profile((id < s_index.count) ? id : s_index.count - 1);
+  }
+  s_dirty_index = true;
+  s_dirty_active = true;
+  settings_save();
+  settings_cache_invalidate();
+  return true;
+}
+
+// Profiles without a name are called after their position
+void settings_get_profile_name(uint8_t id, char *name, size_t len)
+{
+  const char *stored = "";
+
+  if (id >= s_index.count)
+    return;
+
+  if (id == s_active)
+  {
+    stored = s_settings.name;
+  }
+  else
+  {
+    uint8_t key = s_index.ids[id];
+    settings_name_t *cached = &s_names[key % NAME_CACHE_SIZE];
+    if (cached->id != key)
+    {
+      settings_packed_t packed;
+      settings_read_packed(key, &packed);
+      memcpy(cached->name, packed.name, sizeof(cached->name));
+      cached->name[SETTINGS_NAME_LEN - 1] = '\0';
+      cached->id = key;
+    }
+    stored = cached->name;
+  }
+
+  if (stored[0])
+    snprintf(name, len, "%s", stored);
+  else
+    snprintf(name, len, "%s %d", TXT_PROFILE, (int)id + 1);
+}
+
+// Names the active profile, an empty name gives it the default one back
+void settings_set_profile_name(const char *name)
+{
+  if (strncmp(s_settings.name, name, SETTINGS_NAME_LEN - 1) == 0)
+    return;
+
+  snprintf(s_settings.name, sizeof(s_settings.name), "%s", name);
+  s_dirty = true;
+  settings_cache_invalidate();
+}
+
+void settings_set_mode(rctimer_mode_t mode){
+  if (s_mode != mode)
+  {
+    s_mode = mode;
+    s_dirty_mode = true;
+  }
+}
+
+rctimer_mode_t settings_get_mode(void){
+  return s_mode;
 }
 
 void settings_push_window(SettingsCallback callback){
+  // The settings windows are not needed to start a race, create them on first use
+  if (!window)
+  {
+    HEAP_CHECK_START();
+    win_duration_init();
+    win_profiles_init();
+    win_name_init();
+    win_program_init();
+    win_history_init();
+    about_init();
+
+    window = window_create();
+    window_set_window_handlers(window, (WindowHandlers) {
+      .load = window_load,
+      .appear = window_appear,
+      .unload = window_unload,
+    });
+    HEAP_CHECK_STOP();
+  }
+
   s_callback = callback;
   window_stack_push(window,true);
 }
@@ -419,50 +1266,59 @@ void settings_push_window(SettingsCallback callback){
 void settings_init()
 {
   HEAP_CHECK_START();
-
   settings_load();
-  win_duration_init();
-  about_init();
-
-  window = window_create();
-  window_set_window_handlers(window, (WindowHandlers) {
-    .load = window_load,
-    .unload = window_unload,
-  });
   HEAP_CHECK_STOP();
 }
 
 void settings_deinit(void) {
   HEAP_CHECK_START();
-  about_deinit();
-  win_duration_deinit();
+  if (window)
+  {
+    about_deinit();
+    win_history_deinit();
+    win_program_deinit();
+    win_name_deinit();
+    win_profiles_deinit();
+    win_duration_deinit();
+    window_destroy_safe(window);
+  }
   settings_save();
-  window_destroy(window);
   HEAP_CHECK_STOP();
 }
 
 
 static void pre_race_duration_callback(uint32_t duration) {
   settings()->pre_race_duration = duration;
+  settings_mark_dirty();
 }
 
 static void pre_race_interval_callback(uint32_t duration) {
   settings()->pre_race_interval = duration;
+  settings_mark_dirty();
 }
 
 static void race_duration_callback(uint32_t duration) {
   settings()->race_duration = duration;
+  settings_mark_dirty();
 }
 
 static void race_interval_callback(uint32_t duration) {
   settings()->race_interval = duration;
+  settings_mark_dirty();
 }
 
 static void race_over_warn_callback(uint32_t duration) {
   settings()->race_over_warning = duration;
+  settings_mark_dirty();
+}
+
+static void race_alert_callback(uint32_t duration) {
+  settings()->race_alerts[s_alert_edit] = duration;
+  settings_mark_dirty();
 }
 
 static void after_race_interval_callback(uint32_t duration) {
   settings()->after_race_interval = duration;
+  settings_mark_dirty();
 }
 
@@ -2,12 +2,32 @@
 
 #include "../timer.h"
 
-#define SETTINGS_VERSION_CURRENT 2
+#define SETTINGS_VERSION_CURRENT 7
+#define SETTINGS_VERSION_6       6
+#define SETTINGS_VERSION_5       5
+#define SETTINGS_VERSION_4       4
+#define SETTINGS_VERSION_3       3
+#define SETTINGS_VERSION_2       2
 #define SETTINGS_VERSION_OLD_0   0
 
 #define OLD_SETTINGS_KEY 1              // This key holds the old settings
-#define SETTINGS_KEY     2              // This key holds the V2 settings
+#define SETTINGS_KEY     2              // This key holds the V2 and V3 settings, removed in V4
 #define SETTINGS_VERSION_KEY 101        // This key holds the version of the setting format
+#define SETTINGS_MODE_KEY    102        // This key holds the rctimer_mode_t
+#define SETTINGS_ACTIVE_KEY  103        // This key holds the active profile
+#define SETTINGS_INDEX_KEY   104        // This key holds the profile index, from V6
+#define SETTINGS_PROFILE_KEY 110        // This key + profile id holds the V4 to V7 profile settings
+
+// Persistent storage holds 4 KB per app. The history takes 8 chunks of 256
+// bytes and its index, the run state, the worker heat and the other settings
+// keys about 100 bytes more. The profiles and their index get the rest.
+#define SETTINGS_STORE_SIZE      1800   // bytes for the profiles and their index
+#define SETTINGS_MAX_PROFILES    19     // profiles of SETTINGS_CLASSIC_PHASES that fit
+#define SETTINGS_LEGACY_PROFILES 5      // profiles of the formats before V6
+#define SETTINGS_MAX_ALERTS      4      // race alert points of a profile
+#define SETTINGS_NAME_LEN        12
+#define SETTINGS_MAX_PHASES      8      // phases of a program
+#define SETTINGS_CLASSIC_PHASES  3      // phases of the classic program at most
 
 
 typedef enum rctimer_mode_t
@@ -43,6 +63,140 @@ typedef struct {
   TimerVibration  race_over_vibe;
 
   uint32_t        after_race_interval;
+} settings_v2_t;
+
+
+typedef struct {
+  uint32_t        pre_race_duration; // timer duration before racetimer starts
+  uint32_t        pre_race_interval;
+  TimerVibration  pre_race_over_vibe;
+
+  uint32_t        race_duration;    // race timer duration
+  uint32_t        race_interval;
+  uint32_t        race_over_warning;
+  TimerVibration  race_over_vibe;
+
+  uint32_t        after_race_interval;
+
+  TimerResolution pre_race_resolution;
+  TimerResolution race_resolution;
+  TimerResolution after_race_resolution;
+} settings_v3_t;
+
+
+// V4 profile as stored, durations in sec
+typedef struct __attribute__((__packed__)) {
+  uint16_t        pre_race_duration;
+  uint16_t        pre_race_interval;
+  uint16_t        race_duration;
+  uint16_t        race_interval;
+  uint16_t        race_over_warning;
+  uint16_t        after_race_interval;
+  uint8_t         vibes;            // pre race | race << 4
+  uint8_t         resolution;       // pre race | race << 1 | after race << 2
+} settings_packed_v4_t;
+
+
+// V5 profile as stored, the V4 one with the race alert points appended
+typedef struct __attribute__((__packed__)) {
+  uint16_t        pre_race_duration;
+  uint16_t        pre_race_interval;
+  uint16_t        race_duration;
+  uint16_t        race_interval;
+  uint16_t        race_over_warning;
+  uint16_t        after_race_interval;
+  uint8_t         vibes;            // pre race | race << 4
+  uint8_t         resolution;       // pre race | race << 1 | after race << 2
+  uint16_t        race_alerts[SETTINGS_MAX_ALERTS];
+} settings_packed_v5_t;
+
+
+// V6 profile as stored, the V5 one with the name appended
+typedef struct __attribute__((__packed__)) {
+  uint16_t        pre_race_duration;
+  uint16_t        pre_race_interval;
+  uint16_t        race_duration;
+  uint16_t        race_interval;
+  uint16_t        race_over_warning;
+  uint16_t        after_race_interval;
+  uint8_t         vibes;            // pre race | race << 4
+  uint8_t         resolution;       // pre race | race << 1 | after race << 2
+  uint16_t        race_alerts[SETTINGS_MAX_ALERTS];
+  char            name[SETTINGS_NAME_LEN];
+} settings_packed_v6_t;
+
+
+// Phase types, in the order of the history phases. The type sets the clock
+// line and the progress bar of the phase.
+typedef enum {
+  SETTINGS_PHASE_PRE_RACE,          // upper line, the bar empties
+  SETTINGS_PHASE_RACE,              // lower line, the bar fills
+  SETTINGS_PHASE_AFTER_RACE,        // lower line, the bar is kept
+  SETTINGS_NUM_PHASE_TYPES
+} settings_phase_type_t;
+
+// The phases are not packed, they are laid out without padding so the
+// stored form is the one run and the alerts can be handed to the timer
+typedef struct {
+  uint8_t         type;             // settings_phase_type_t
+  uint8_t         end_vibe;         // TimerVibration
+  uint8_t         resolution;       // TimerResolution
+  uint8_t         reserved;
+  uint16_t        duration;         // sec, 0 counts up until select is pressed
+  uint16_t        interval;         // sec between vibes, 0 if none
+  uint16_t        warning;          // sec before the end with a vibe every sec
+  uint16_t        alerts[SETTINGS_MAX_ALERTS]; // remaining time, sec, 0 if unused
+} settings_phase_t;
+
+// A program as stored and as run. A profile without phases runs the program
+// made of its pre race, race and after race settings.
+typedef struct {
+  uint8_t         num_phases;
+  uint8_t         reserved;
+  settings_phase_t phases[SETTINGS_MAX_PHASES];
+} settings_program_t;
+
+
+// V7 profile as stored, the V6 one with the program appended
+typedef struct __attribute__((__packed__)) {
+  uint16_t        pre_race_duration;
+  uint16_t        pre_race_interval;
+  uint16_t        race_duration;
+  uint16_t        race_interval;
+  uint16_t        race_over_warning;
+  uint16_t        after_race_interval;
+  uint8_t         vibes;            // pre race | race << 4
+  uint8_t         resolution;       // pre race | race << 1 | after race << 2
+  uint16_t        race_alerts[SETTINGS_MAX_ALERTS];
+  char            name[SETTINGS_NAME_LEN];
+  settings_program_t program;
+} settings_packed_t;
+
+// Bytes a V7 profile is stored in, the program only up to its last phase.
+// Shorter records read with the phases after it zero.
+#define SETTINGS_PACKED_SIZE(num_phases) \
+  (offsetof(settings_packed_t, program.phases) + (num_phases) * sizeof(settings_phase_t))
+
+
+typedef struct {
+  uint32_t        pre_race_duration; // timer duration before racetimer starts
+  uint32_t        pre_race_interval;
+  TimerVibration  pre_race_over_vibe;
+
+  uint32_t        race_duration;    // race timer duration
+  uint32_t        race_interval;
+  uint32_t        race_over_warning;
+  TimerVibration  race_over_vibe;
+
+  uint32_t        after_race_interval;
+
+  TimerResolution pre_race_resolution;
+  TimerResolution race_resolution;
+  TimerResolution after_race_resolution;
+
+  uint16_t        race_alerts[SETTINGS_MAX_ALERTS]; // remaining race time, sec, 0 if unused
+  char            name[SETTINGS_NAME_LEN];          // empty if not named
+  settings_program_t program;                       // no phases for the classic program
 } settings_t;
 
 typedef void (*SettingsCallback)(void);
@@ -57,5 +211,20 @@ void settings_push_window(SettingsCallback callback);
 uint8_t settings_get_num_of_profiles(void);
 void settings_set_active_profile(uint8_t);
 uint8_t settings_get_active_profile(void);
+uint8_t settings_get_active_profile_id(void);
+bool settings_add_profile(void);
+bool settings_delete_profile(uint8_t);
+void settings_get_profile_name(uint8_t, char *name, size_t len);
+void settings_set_profile_name(const char *name);
+
+// Program of the active profile, checked and compiled when loaded and saved
+const settings_program_t* settings_program(void);
+settings_phase_t* settings_edit_phase(uint8_t index);
+bool settings_add_phase(void);
+bool settings_remove_phase(void);
+void settings_clear_program(void);
+
+void settings_set_mode(rctimer_mode_t mode);
+rctimer_mode_t settings_get_mode(void);
 
 
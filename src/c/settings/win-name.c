@@ -0,0 +1,153 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include <utils/bitmap-loader.h>
+#include "../icons.h"
+#include "settings.h"
+#include "win-name.h"
+
+// Name editor: up and down change the letter at the cursor, select moves the
+// cursor to the next letter and back hands the name over, like the duration
+// editor. The letters are drawn in cells of the same width so the cursor
+// sits under its letter whatever the font.
+
+#define NAME_CHARS      " ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-"
+#define NAME_LEN        (SETTINGS_NAME_LEN - 1)
+#define NAME_CELL_W     10
+
+static Window* s_window;
+static Layer* s_layer;
+static ActionBarLayer* s_action_bar;
+static NameCallback s_callback;
+static char *s_header;
+
+static char s_name[NAME_LEN + 1];
+static uint8_t s_cursor = 0;
+
+HEAP_CHECK;
+
+// Position in NAME_CHARS, a letter not in it counts as a space
+static uint8_t name_char_index(char c)
+{
+  const char *found = strchr(NAME_CHARS, (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c);
+  return (found && c) ? found - NAME_CHARS : 0;
+}
+
+static void name_char_step(int8_t step)
+{
+  const uint8_t count = strlen(NAME_CHARS);
+  uint8_t index = (name_char_index(s_name[s_cursor]) + count + step) % count;
+
+  s_name[s_cursor] = NAME_CHARS[index];
+  layer_mark_dirty(s_layer);
+}
+
+static void up_handler(ClickRecognizerRef recognizer, void *context) {
+  name_char_step(1);
+}
+
+static void down_handler(ClickRecognizerRef recognizer, void *context) {
+  name_char_step(-1);
+}
+
+static void select_handler(ClickRecognizerRef recognizer, void *context) {
+  s_cursor = (s_cursor + 1) % NAME_LEN;
+  layer_mark_dirty(s_layer);
+}
+
+static void click_config_provider(void *context) {
+  window_single_repeating_click_subscribe(BUTTON_ID_UP, 100, up_handler);
+  window_single_repeating_click_subscribe(BUTTON_ID_DOWN, 100, down_handler);
+  window_single_click_subscribe(BUTTON_ID_SELECT, select_handler);
+}
+
+static void layer_update(Layer* me, GContext* ctx) {
+  GRect bounds = layer_get_bounds(me);
+  int16_t left = (bounds.size.w - ACTION_BAR_WIDTH - NAME_LEN * NAME_CELL_W) / 2;
+  GFont font = fonts_get_system_font(FONT_KEY_GOTHIC_24_BOLD);
+
+#if defined(PBL_PLATFORM_APLITE)
+  graphics_context_set_fill_color(ctx, GColorBlack);
+#else
+  graphics_context_set_fill_color(ctx, GColorGreen);
+#endif
+  graphics_context_set_text_color(ctx, GColorBlack);
+
+  graphics_draw_text(ctx, s_header, fonts_get_system_font(FONT_KEY_GOTHIC_18_BOLD),
+      (GRect){
+#if defined(PBL_ROUND)
+        .origin = { 10, 25 },
+#else
+        .origin = { 0, 15 },
+#endif
+        .size = { bounds.size.w - ACTION_BAR_WIDTH - 3, 40 }
+      },
+    GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+
+  graphics_fill_rect(ctx, (GRect) {
+      .origin = { left + s_cursor * NAME_CELL_W, 104 },
+      .size = { NAME_CELL_W - 1, 3 } }, 0, GCornerNone);
+
+  for (uint8_t i = 0; i < NAME_LEN; i++)
+  {
+    char letter[2] = { s_name[i], '\0' };
+    graphics_draw_text(ctx, letter, font,
+        (GRect) { .origin = { left + i * NAME_CELL_W, 74 }, .size = { NAME_CELL_W, 30 } },
+      GTextOverflowModeFill, GTextAlignmentCenter, NULL);
+  }
+}
+
+static void window_load(Window* window) {
+  s_layer = layer_create_fullscreen(s_window);
+  layer_set_update_proc(s_layer, layer_update);
+  layer_add_to_window(s_layer, s_window);
+
+  s_action_bar = action_bar_layer_create();
+#if !defined(PBL_PLATFORM_APLITE)
+  action_bar_layer_set_background_color(s_action_bar, GColorBlue);
+#endif
+  action_bar_layer_add_to_window(s_action_bar, s_window);
+  action_bar_layer_set_click_config_provider(s_action_bar, click_config_provider);
+  action_bar_layer_set_icon(s_action_bar, BUTTON_ID_UP, bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_ACTION_INC));
+  action_bar_layer_set_icon(s_action_bar, BUTTON_ID_SELECT, bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_UP_DOWN));
+  action_bar_layer_set_icon(s_action_bar, BUTTON_ID_DOWN, bitmaps_get_sub_bitmap(RESOURCE_ID_ICONS, ICON_RECT_ACTION_DEC));
+}
+
+static void window_unload(Window* window) {
+  int8_t end = NAME_LEN;
+
+  while (end > 0 && s_name[end - 1] == ' ')
+    end--;
+  s_name[end] = '\0';
+  s_callback(s_name);
+
+  action_bar_layer_destroy(s_action_bar);
+  layer_destroy(s_layer);
+}
+
+void win_name_init(void) {
+  HEAP_CHECK_START();
+  s_window = window_create();
+  window_set_window_handlers(s_window, (WindowHandlers) {
+    .load = window_load,
+    .unload = window_unload,
+  });
+  HEAP_CHECK_STOP();
+}
+
+void win_name_deinit(void) {
+  window_destroy_safe(s_window);
+}
+
+// The name is padded with spaces to its full length while edited
+void win_name_show(const char *name, NameCallback callback, char *header) {
+  s_callback = callback;
+  s_header = header;
+  s_cursor = 0;
+  for (uint8_t i = 0; i < NAME_LEN; i++)
+  {
+    char c = (name && i < strlen(name)) ? name[i] : ' ';
+    s_name[i] = NAME_CHARS[name_char_index(c)];
+  }
+  s_name[NAME_LEN] = '\0';
+  window_stack_push(s_window, true);
+}
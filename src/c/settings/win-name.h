@@ -0,0 +1,10 @@
+#pragma once
+
+#include <pebble.h>
+
+// Gets the name edited, trailing spaces removed, empty if all were
+typedef void (*NameCallback)(const char *name);
+
+void win_name_init(void);
+void win_name_deinit(void);
+void win_name_show(const char *name, NameCallback callback, char *header);
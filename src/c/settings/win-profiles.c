@@ -0,0 +1,163 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "../log.h"
+#include "settings.h"
+#include "win-profiles.h"
+#include "win-name.h"
+
+// Profile list: select activates a profile and on the active one edits its
+// name. Long select asks to delete a profile, a select on it then deletes it
+// and any other click or move keeps it. The last row adds a copy of the
+// active one, or says the storage is full. Names are read through the name cache of the settings, only
+// for the rows drawn.
+
+#define TXT_SELECT_PROFILE  "Select Profile"
+#define TXT_NEW_PROFILE     "New Profile"
+#define TXT_ACTIVE          "Active"
+#define TXT_DELETE          "Select to delete"
+#define TXT_PROFILE_NAME    "Profile Name"
+#define TXT_STORAGE_FULL    "Storage full"
+
+#define NO_ROW              UINT16_MAX
+
+static Window *s_window;
+static MenuLayer *s_menu_layer;
+static uint16_t s_delete_row = NO_ROW;  // asked to delete, not confirmed yet
+static bool s_full = false;             // a new profile did not fit
+
+HEAP_CHECK;
+
+static uint16_t menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  uint8_t count = settings_get_num_of_profiles();
+  return (count < SETTINGS_MAX_PROFILES) ? count + 1 : count;
+}
+
+static int16_t menu_get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  return MENU_CELL_BASIC_HEADER_HEIGHT;
+}
+
+static void menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data) {
+  menu_cell_basic_header_draw(ctx, cell_layer, TXT_SELECT_PROFILE);
+}
+
+static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
+  char name[SETTINGS_NAME_LEN];
+
+  if (cell_index->row >= settings_get_num_of_profiles())
+  {
+    if (s_full)
+      menu_cell_basic_draw(ctx, cell_layer, TXT_NEW_PROFILE, TXT_STORAGE_FULL, NULL);
+    else
+      menu_cell_title_draw(ctx, cell_layer, TXT_NEW_PROFILE);
+    return;
+  }
+
+  settings_get_profile_name(cell_index->row, name, sizeof(name));
+  if (cell_index->row == s_delete_row)
+    menu_cell_basic_draw(ctx, cell_layer, name, TXT_DELETE, NULL);
+  else
+    menu_cell_basic_draw(ctx, cell_layer, name,
+                         (cell_index->row == settings_get_active_profile()) ? TXT_ACTIVE : NULL, NULL);
+}
+
+static void name_callback(const char *name) {
+  settings_set_profile_name(name);
+}
+
+static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
+  if (cell_index->row == s_delete_row)
+  {
+    s_delete_row = NO_ROW;
+    if (settings_delete_profile(cell_index->row))
+    {
+      DEBUG("Profile %d deleted", cell_index->row);
+      s_full = false;
+    }
+    menu_layer_reload_data(menu_layer);
+    return;
+  }
+  if (s_delete_row != NO_ROW)
+  {
+    s_delete_row = NO_ROW;
+    menu_layer_reload_data(menu_layer);
+  }
+
+  if (cell_index->row == settings_get_active_profile())
+  {
+    win_name_show(settings()->name, name_callback, TXT_PROFILE_NAME);
+    return;
+  }
+  if (cell_index->row >= settings_get_num_of_profiles())
+  {
+    s_full = !settings_add_profile();
+    menu_layer_reload_data(menu_layer);
+    return;
+  }
+
+  settings_set_active_profile(cell_index->row);
+  window_stack_pop(true);
+}
+
+// The last profile is never deleted, it is not asked for
+static void menu_select_long_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
+  if (cell_index->row < settings_get_num_of_profiles() && settings_get_num_of_profiles() > 1)
+  {
+    s_delete_row = cell_index->row;
+    menu_layer_reload_data(menu_layer);
+  }
+}
+
+static void menu_selection_changed_callback(MenuLayer *menu_layer, MenuIndex new_index, MenuIndex old_index, void *data) {
+  if (s_delete_row != NO_ROW)
+  {
+    s_delete_row = NO_ROW;
+    menu_layer_reload_data(menu_layer);
+  }
+}
+
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  GRect bounds = layer_get_frame(window_layer);
+
+  s_delete_row = NO_ROW;
+  s_full = false;
+  s_menu_layer = menu_layer_create(bounds);
+  menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks){
+    .get_num_rows = menu_get_num_rows_callback,
+    .get_header_height = menu_get_header_height_callback,
+    .draw_header = menu_draw_header_callback,
+    .draw_row = menu_draw_row_callback,
+    .select_click = menu_select_callback,
+    .select_long_click = menu_select_long_callback,
+    .selection_changed = menu_selection_changed_callback,
+  });
+  menu_layer_set_click_config_onto_window(s_menu_layer, window);
+#if !defined(PBL_PLATFORM_APLITE)
+  menu_layer_set_highlight_colors(s_menu_layer, GColorYellow, GColorBlack);
+#endif
+  menu_layer_set_selected_index(s_menu_layer, (MenuIndex) { 0, settings_get_active_profile() },
+                                MenuRowAlignCenter, false);
+  layer_add_child(window_layer, menu_layer_get_layer(s_menu_layer));
+}
+
+static void window_unload(Window *window) {
+  menu_layer_destroy(s_menu_layer);
+}
+
+void win_profiles_init(void) {
+  HEAP_CHECK_START();
+  s_window = window_create();
+  window_set_window_handlers(s_window, (WindowHandlers) {
+    .load = window_load,
+    .unload = window_unload,
+  });
+  HEAP_CHECK_STOP();
+}
+
+void win_profiles_deinit(void) {
+  window_destroy_safe(s_window);
+}
+
+void win_profiles_show(void) {
+  window_stack_push(s_window, true);
+}
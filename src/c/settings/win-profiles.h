@@ -0,0 +1,7 @@
+#pragma once
+
+#include <pebble.h>
+
+void win_profiles_init(void);
+void win_profiles_deinit(void);
+void win_profiles_show(void);
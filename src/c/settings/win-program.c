@@ -0,0 +1,273 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "../log.h"
+#include "settings.h"
+#include "win-duration.h"
+#include "win-program.h"
+
+// Program editor: a section for each phase and one to add or remove phases.
+// The rows show the program as it runs, a profile without its own program
+// shows the classic one and gets a copy of it on the first change. A phase
+// the storage has no room for is refused, the add row says so.
+
+#define TXT_PHASE           "Phase"
+#define TXT_TYPE            "Type"
+#define TXT_DURATION        "Duration"
+#define TXT_COUNT_UP        "Count Up"
+#define TXT_VIBE_INTERVAL   "Vibe Interval"
+#define TXT_WARNING         "End Warning"
+#define TXT_END_VIBE        "End Vibe"
+#define TXT_DISPLAY         "Display"
+#define TXT_ALERT           "Alert"
+#define TXT_OFF             "Off"
+#define TXT_PROGRAM         "Program"
+#define TXT_ADD_PHASE       "Add Phase"
+#define TXT_REMOVE_PHASE    "Remove Last Phase"
+#define TXT_CLASSIC         "Classic Program"
+#define TXT_STORAGE_FULL    "Storage full"
+
+// Phase section
+#define NUM_PHASE_ITEMS         (6 + SETTINGS_MAX_ALERTS)
+#define MENU_PHASE_TYPE         0
+#define MENU_PHASE_DURATION     1
+#define MENU_PHASE_INTERVAL     2
+#define MENU_PHASE_WARNING      3
+#define MENU_PHASE_END_VIBE     4
+#define MENU_PHASE_DISPLAY      5
+#define MENU_PHASE_ALERT        6   // first of SETTINGS_MAX_ALERTS rows
+
+// Program section, after the phases
+#define NUM_PROGRAM_ITEMS       3
+#define MENU_PROGRAM_ADD        0
+#define MENU_PROGRAM_REMOVE     1
+#define MENU_PROGRAM_CLASSIC    2
+
+#define ROW_STR_SIZE            10
+
+static Window *s_window;
+static MenuLayer *s_menu_layer;
+
+// value being edited
+static uint8_t s_edit_phase = 0;
+static uint8_t s_edit_row = 0;
+
+static bool s_full = false;             // a phase added did not fit
+
+static const char *PHASE_TYPES[SETTINGS_NUM_PHASE_TYPES] = {
+  "Pre Race", "Race", "After Race"
+};
+
+static const char *ALERT_TITLES[SETTINGS_MAX_ALERTS] = {
+  TXT_ALERT" 1", TXT_ALERT" 2", TXT_ALERT" 3", TXT_ALERT" 4"
+};
+
+HEAP_CHECK;
+
+static uint16_t menu_get_num_sections_callback(MenuLayer *menu_layer, void *data) {
+  return settings_program()->num_phases + 1;
+}
+
+static uint16_t menu_get_num_rows_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  return (section_index < settings_program()->num_phases) ? NUM_PHASE_ITEMS : NUM_PROGRAM_ITEMS;
+}
+
+static int16_t menu_get_header_height_callback(MenuLayer *menu_layer, uint16_t section_index, void *data) {
+  return MENU_CELL_BASIC_HEADER_HEIGHT;
+}
+
+static void menu_draw_header_callback(GContext* ctx, const Layer *cell_layer, uint16_t section_index, void *data) {
+  char header[16];
+
+  if (section_index < settings_program()->num_phases)
+  {
+    snprintf(header, sizeof(header), TXT_PHASE" %d", section_index + 1);
+    menu_cell_basic_header_draw(ctx, cell_layer, header);
+  }
+  else
+  {
+    menu_cell_basic_header_draw(ctx, cell_layer, TXT_PROGRAM);
+  }
+}
+
+static void menu_draw_time(GContext* ctx, const Layer *cell_layer, const char *title, uint16_t time, const char *none) {
+  char str[ROW_STR_SIZE];
+
+  if (time)
+  {
+    timer_time_str(time, str, sizeof(str));
+    menu_cell_basic_draw(ctx, cell_layer, title, str, NULL);
+  }
+  else
+  {
+    menu_cell_basic_draw(ctx, cell_layer, title, none, NULL);
+  }
+}
+
+static void menu_draw_row_callback(GContext* ctx, const Layer *cell_layer, MenuIndex *cell_index, void *data) {
+  const settings_program_t *program = settings_program();
+  const settings_phase_t *phase;
+
+  if (cell_index->section >= program->num_phases)
+  {
+    switch (cell_index->row) {
+      case MENU_PROGRAM_ADD:
+        if (s_full)
+          menu_cell_basic_draw(ctx, cell_layer, TXT_ADD_PHASE, TXT_STORAGE_FULL, NULL);
+        else
+          menu_cell_title_draw(ctx, cell_layer, TXT_ADD_PHASE);
+        break;
+      case MENU_PROGRAM_REMOVE:
+        menu_cell_title_draw(ctx, cell_layer, TXT_REMOVE_PHASE);
+        break;
+      case MENU_PROGRAM_CLASSIC:
+        menu_cell_title_draw(ctx, cell_layer, TXT_CLASSIC);
+        break;
+    }
+    return;
+  }
+
+  phase = &program->phases[cell_index->section];
+  switch (cell_index->row) {
+    case MENU_PHASE_TYPE:
+      menu_cell_basic_draw(ctx, cell_layer, TXT_TYPE, PHASE_TYPES[phase->type], NULL);
+      break;
+    case MENU_PHASE_DURATION:
+      menu_draw_time(ctx, cell_layer, TXT_DURATION, phase->duration, TXT_COUNT_UP);
+      break;
+    case MENU_PHASE_INTERVAL:
+      menu_draw_time(ctx, cell_layer, TXT_VIBE_INTERVAL, phase->interval, TXT_OFF);
+      break;
+    case MENU_PHASE_WARNING:
+      menu_draw_time(ctx, cell_layer, TXT_WARNING, phase->warning, TXT_OFF);
+      break;
+    case MENU_PHASE_END_VIBE:
+      menu_cell_basic_draw(ctx, cell_layer, TXT_END_VIBE, timer_vibe_str(phase->end_vibe, true), NULL);
+      break;
+    case MENU_PHASE_DISPLAY:
+      menu_cell_basic_draw(ctx, cell_layer, TXT_DISPLAY, timer_resolution_str(phase->resolution), NULL);
+      break;
+    default:
+      menu_draw_time(ctx, cell_layer, ALERT_TITLES[cell_index->row - MENU_PHASE_ALERT],
+                     phase->alerts[cell_index->row - MENU_PHASE_ALERT], TXT_OFF);
+      break;
+  }
+}
+
+static void phase_time_callback(uint32_t duration) {
+  settings_phase_t *phase = settings_edit_phase(s_edit_phase);
+
+  switch (s_edit_row) {
+    case MENU_PHASE_DURATION:
+      phase->duration = duration;
+      break;
+    case MENU_PHASE_INTERVAL:
+      phase->interval = duration;
+      break;
+    case MENU_PHASE_WARNING:
+      phase->warning = duration;
+      break;
+    default:
+      phase->alerts[s_edit_row - MENU_PHASE_ALERT] = duration;
+      break;
+  }
+}
+
+static void menu_select_callback(MenuLayer *menu_layer, MenuIndex *cell_index, void *data) {
+  const settings_phase_t *shown;
+  settings_phase_t *phase;
+
+  if (cell_index->section >= settings_program()->num_phases)
+  {
+    // under SETTINGS_MAX_PHASES a phase is only refused for the storage
+    s_full = false;
+    switch (cell_index->row) {
+      case MENU_PROGRAM_ADD:
+        s_full = !settings_add_phase() && settings_program()->num_phases < SETTINGS_MAX_PHASES;
+        break;
+      case MENU_PROGRAM_REMOVE:
+        settings_remove_phase();
+        break;
+      case MENU_PROGRAM_CLASSIC:
+        settings_clear_program();
+        break;
+    }
+    menu_layer_reload_data(menu_layer);
+    return;
+  }
+
+  s_edit_phase = cell_index->section;
+  s_edit_row = cell_index->row;
+  shown = &settings_program()->phases[s_edit_phase];
+  switch (cell_index->row) {
+    case MENU_PHASE_TYPE:
+      phase = settings_edit_phase(s_edit_phase);
+      phase->type = (phase->type + 1) % SETTINGS_NUM_PHASE_TYPES;
+      break;
+    case MENU_PHASE_DURATION:
+      // 0 counts up until select is pressed
+      win_duration_show(shown->duration, phase_time_callback, true, (TXT_PHASE" "TXT_DURATION));
+      break;
+    case MENU_PHASE_INTERVAL:
+      win_duration_show(shown->interval, phase_time_callback, true, (TXT_PHASE" "TXT_VIBE_INTERVAL));
+      break;
+    case MENU_PHASE_WARNING:
+      win_duration_show(shown->warning, phase_time_callback, false, (TXT_PHASE" "TXT_WARNING));
+      break;
+    case MENU_PHASE_END_VIBE:
+      phase = settings_edit_phase(s_edit_phase);
+      phase->end_vibe = (phase->end_vibe + 1) % TIMER_VIBE_MAX;
+      break;
+    case MENU_PHASE_DISPLAY:
+      phase = settings_edit_phase(s_edit_phase);
+      phase->resolution = (phase->resolution + 1) % TIMER_RES_MAX;
+      break;
+    default:
+      // remaining phase time to vibrate at, 0 turns the alert off
+      win_duration_show(shown->alerts[s_edit_row - MENU_PHASE_ALERT], phase_time_callback, true, (TXT_PHASE" "TXT_ALERT));
+      break;
+  }
+  layer_mark_dirty(menu_layer_get_layer(menu_layer));
+}
+
+static void window_load(Window *window) {
+  Layer *window_layer = window_get_root_layer(window);
+  GRect bounds = layer_get_frame(window_layer);
+
+  s_full = false;
+  s_menu_layer = menu_layer_create(bounds);
+  menu_layer_set_callbacks(s_menu_layer, NULL, (MenuLayerCallbacks){
+    .get_num_sections = menu_get_num_sections_callback,
+    .get_num_rows = menu_get_num_rows_callback,
+    .get_header_height = menu_get_header_height_callback,
+    .draw_header = menu_draw_header_callback,
+    .draw_row = menu_draw_row_callback,
+    .select_click = menu_select_callback,
+  });
+  menu_layer_set_click_config_onto_window(s_menu_layer, window);
+#if !defined(PBL_PLATFORM_APLITE)
+  menu_layer_set_highlight_colors(s_menu_layer, GColorYellow, GColorBlack);
+#endif
+  layer_add_child(window_layer, menu_layer_get_layer(s_menu_layer));
+}
+
+static void window_unload(Window *window) {
+  menu_layer_destroy(s_menu_layer);
+}
+
+void win_program_init(void) {
+  HEAP_CHECK_START();
+  s_window = window_create();
+  window_set_window_handlers(s_window, (WindowHandlers) {
+    .load = window_load,
+    .unload = window_unload,
+  });
+  HEAP_CHECK_STOP();
+}
+
+void win_program_deinit(void) {
+  window_destroy_safe(s_window);
+}
+
+void win_program_show(void) {
+  window_stack_push(s_window, true);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <pebble.h>
+
+void win_program_init(void);
+void win_program_deinit(void);
+void win_program_show(void);
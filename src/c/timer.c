@@ -31,12 +31,38 @@ src/timer.c
 
 #include <pebble.h>
 #include <utils/pebble-assist.h>
+#include "log.h"
 #include "timer.h"
+#include "haptic.h"
+#include "trace/trace.h"
+#include "perf/perf.h"
 #include "icons.h"
 //#include "settings.h"
 //#include "windows/win-vibrate.h"
 
 #define TIMER_RESOLUTION 10  // 0.01 sec resolution 1sec * 100
+#define TIMER_TICK_MS    (1000 / TIMER_RESOLUTION)
+
+#define TIMER_MAX_RUNNING  8                    // timers alive, all can share the wakeup
+#define TIMER_COALESCE_MS  (TIMER_TICK_MS / 2)  // max delay to share a wakeup
+
+// Timers are taken from a static pool of TIMER_POOL_SIZE objects, which
+// avoids heap fragmentation on aplite. 0 allocates them on the heap.
+#ifndef TIMER_POOL_SIZE
+#if defined(PBL_PLATFORM_APLITE)
+#define TIMER_POOL_SIZE 4
+#else
+#define TIMER_POOL_SIZE 0
+#endif
+#endif
+
+#if TIMER_POOL_SIZE > TIMER_MAX_RUNNING
+#error "TIMER_POOL_SIZE exceeds the wakeup heap"
+#endif
+
+#define TIMER_POOL_NONE 0xFF
+
+#define TIMER_NO_ALERT  UINT32_MAX
 
 typedef enum {
   TIMER_TYPE_STOPWATCH = 0,
@@ -45,22 +71,30 @@ typedef enum {
 
 typedef struct _Timer {
   TimerType       type;
-  AppTimer*       timer;
+  uint32_t        deadline_ms;  // wall clock (ms) of the next tick
+  uint8_t         heap_pos;     // position in the wakeup heap + 1, 0 if not scheduled
   uint32_t        length;     // if 0 the it is a stopwatch
   uint32_t        current_time;
   TimerStatus     status;
   TimerVibration  expired_vibration;
   uint32_t        vib_interval;
   uint32_t        before_expired_length;
+  uint32_t        display_step; // ticks between changes of the displayed time
+  uint16_t        alert_points[TIMER_MAX_ALERT_POINTS]; // sec of displayed time, 0 if unused
   TimerCallback_t update_cb;
   TimerCallback_t expired_cb;
 // helper var
-  uint32_t        vib_interval_counter;   // count down to vib
-  bool            vib_pre_done_time_reached;
+  uint32_t        start_ms;     // wall clock (ms) at which elapsed time was 0
+  uint32_t        elapsed_ms;   // elapsed time frozen while not running
+  uint32_t        alert_at[TIMER_MAX_ALERT_POINTS]; // alert points in elapsed ticks, sorted
+  uint8_t         alert_count;
+  uint8_t         alert_cursor; // first alert point not passed yet
+  uint32_t        next_alert;   // elapsed ticks of the next alert
+  HapticAlert     next_alert_type;
 } sTimer;
 
 
-static void timer_tick(void* context);
+static void timer_tick(sTimer* timer);
 static void timer_finish(sTimer* timer);
 static void timer_schedule_tick(sTimer* timer);
 static void timer_cancel_tick(sTimer* timer);
@@ -68,54 +102,371 @@ static void timer_completed_action(sTimer* timer);
 static void timer_callback_update(sTimer* timer);
 static void timer_callback_done(sTimer* timer);
 
+// All running timers share one AppTimer. The heap holds the scheduled timers
+// ordered by deadline, the AppTimer is armed for the earliest one.
+static sTimer*   s_heap[TIMER_MAX_RUNNING];
+static uint8_t   s_heap_count = 0;
+static AppTimer* s_wakeup = NULL;
+static bool      s_dispatching = false;
+
+#if TIMER_POOL_SIZE > 0
+// Free list of pool slots, linked by index
+static sTimer  s_pool[TIMER_POOL_SIZE];
+static uint8_t s_pool_next[TIMER_POOL_SIZE];
+static uint8_t s_pool_free = TIMER_POOL_NONE;
+static bool    s_pool_ready = false;
+#endif
+static uint8_t s_pool_used = 0;
+static uint8_t s_pool_peak = 0;
+
+HEAP_CHECK;
+
+// wakeup statistics
+static uint32_t s_wakeups = 0;
+static uint32_t s_wakeups_last_minute = 0;
+static uint32_t s_wakeups_minute_start_ms = 0;
+
 
-static void timer_tick(void* context)
+/******************************************************************************
+  Time keeping
+
+  The timer never counts callbacks. The elapsed time is always derived from
+  the wall clock, so a late app_timer callback can not make the timer drift.
+  timer_now_ms() is the only place the clock is read, a host build can swap
+  it for a virtual clock to step time deterministically.
+******************************************************************************/
+static uint32_t timer_now_ms(void)
 {
-  DEBUG("%s\n",__func__);
-  sTimer* timer = (sTimer*)context;
-  timer->timer = NULL;
+  time_t seconds;
+  uint16_t millis = time_ms(&seconds, NULL);
+  return (uint32_t)seconds * 1000 + millis;
+}
+
+static uint32_t timer_elapsed_ms(sTimer* timer, uint32_t now)
+{
+  if (timer->status != TIMER_STATUS_RUNNING)
+    return timer->elapsed_ms;
+  return now - timer->start_ms;
+}
+
+static void timer_update_time(sTimer* timer, uint32_t now)
+{
+  uint32_t elapsed = timer_elapsed_ms(timer, now) / TIMER_TICK_MS;
+
   switch (timer->type) {
     case TIMER_TYPE_STOPWATCH:
-      timer->current_time += 1;
+      timer->current_time = elapsed;
       break;
     case TIMER_TYPE_TIMER:
-      timer->current_time -= 1;
-      if (timer->current_time <= 0)
-      {
-        timer_finish(timer);
-        return;
-      }
+      timer->current_time = (elapsed < timer->length) ? timer->length - elapsed : 0;
+      break;
   }
+}
 
-  timer_schedule_tick(timer);
-  timer_callback_update(timer);
 
-  // vibration interval
-  if ( timer->current_time % timer->vib_interval == 0)
+static void timer_count_wakeup(uint32_t now)
+{
+  s_wakeups++;
+  if (now - s_wakeups_minute_start_ms >= 60 * 1000)
   {
-    vibes_short_pulse();
-    DEBUG("VIB");
+    DEBUG("wakeups/min %d", (int)s_wakeups);
+    s_wakeups_last_minute = s_wakeups;
+    s_wakeups = 0;
+    s_wakeups_minute_start_ms = now;
   }
+}
 
+/******************************************************************************
+  Alert schedule
 
-  // EOR warning
-  if (timer->type == TIMER_TYPE_TIMER)
+  The alert points are compiled into a sorted table when the timer starts.
+  The next alert, the earliest of the alert points, the interval vibes and
+  the EOR warnings, is kept as an elapsed time, so a tick only compares it
+  and the wakeup is known in advance. It is only searched again once it has
+  passed.
+******************************************************************************/
+static void timer_alert_compile(sTimer* timer)
+{
+  timer->alert_count = 0;
+  timer->alert_cursor = 0;
+  for (uint8_t i = 0; i < TIMER_MAX_ALERT_POINTS; i++)
   {
-    if (timer->current_time <= timer->before_expired_length)
+    uint32_t point = timer->alert_points[i] * TIMER_RESOLUTION;
+    uint32_t at;
+
+    if (point == 0)
+      continue;
+    if (timer->type == TIMER_TYPE_TIMER)
+    {
+      // counting down, the expiry has its own alert
+      if (point >= timer->length)
+        continue;
+      at = timer->length - point;
+    }
+    else
     {
-      // vibrate every 1sec
-      if ( timer->current_time % TIMER_RESOLUTION  == 0)
+      at = point;
+    }
+
+    // insertion sort, there are only a few points
+    uint8_t pos = timer->alert_count++;
+    while (pos > 0 && timer->alert_at[pos - 1] > at)
+    {
+      timer->alert_at[pos] = timer->alert_at[pos - 1];
+      pos--;
+    }
+    timer->alert_at[pos] = at;
+  }
+}
+
+static void timer_alert_candidate(sTimer* timer, uint32_t at, HapticAlert type)
+{
+  if (at < timer->next_alert || (at == timer->next_alert && type > timer->next_alert_type))
+  {
+    timer->next_alert = at;
+    timer->next_alert_type = type;
+  }
+}
+
+// Find the first alert after elapsed (in ticks)
+static void timer_alert_seek(sTimer* timer, uint32_t elapsed)
+{
+  uint32_t remaining, target;
+
+  timer->next_alert = TIMER_NO_ALERT;
+  timer->next_alert_type = HAPTIC_NONE;
+
+  while (timer->alert_cursor < timer->alert_count && timer->alert_at[timer->alert_cursor] <= elapsed)
+    timer->alert_cursor++;
+  while (timer->alert_cursor > 0 && timer->alert_at[timer->alert_cursor - 1] > elapsed)
+    timer->alert_cursor--;
+  if (timer->alert_cursor < timer->alert_count)
+    timer_alert_candidate(timer, timer->alert_at[timer->alert_cursor], HAPTIC_INTERVAL);
+
+  switch (timer->type) {
+    case TIMER_TYPE_STOPWATCH:
+      if (timer->vib_interval)
+        timer_alert_candidate(timer, (elapsed / timer->vib_interval + 1) * timer->vib_interval, HAPTIC_INTERVAL);
+      break;
+    case TIMER_TYPE_TIMER:
+      if (elapsed >= timer->length)
+        break;
+
+      remaining = timer->length - elapsed;
+
+      // interval, counting down
+      if (timer->vib_interval)
       {
-        vibes_short_pulse();
-        DEBUG("VIB");
+        target = ((remaining - 1) / timer->vib_interval) * timer->vib_interval;
+        if (target > 0)
+          timer_alert_candidate(timer, timer->length - target, HAPTIC_INTERVAL);
       }
-    }
+
+      // EOR warning, every second of the warning period
+      if (timer->before_expired_length)
+      {
+        target = ((remaining - 1) / TIMER_RESOLUTION) * TIMER_RESOLUTION;
+        if (target > timer->before_expired_length)
+          target = timer->before_expired_length - (timer->before_expired_length % TIMER_RESOLUTION);
+        if (target > 0)
+          timer_alert_candidate(timer, timer->length - target, HAPTIC_WARNING);
+      }
+      break;
+  }
+}
+
+/******************************************************************************
+  Next deadline
+
+  Returns the elapsed time (in ticks) of the next moment where something
+  happens: the displayed time changes, an alert is due or the timer expires.
+  The tick is only scheduled for that moment.
+******************************************************************************/
+static uint32_t timer_next_deadline(sTimer* timer, uint32_t elapsed)
+{
+  uint32_t step = timer->display_step ? timer->display_step : 1;
+  uint32_t next = (elapsed / step + 1) * step;
+
+  if (timer->type == TIMER_TYPE_TIMER)
+  {
+    if (elapsed >= timer->length)
+      return elapsed;
+
+    // expiry
+    next = (timer->length < next) ? timer->length : next;
+  }
+
+  return (timer->next_alert < next) ? timer->next_alert : next;
+}
+
+/******************************************************************************
+  Shared wakeup
+
+  Deadlines are wall clock ms and may wrap, so they are compared by their
+  signed difference.
+******************************************************************************/
+static bool timer_before(sTimer* a, sTimer* b)
+{
+  return (int32_t)(a->deadline_ms - b->deadline_ms) < 0;
+}
+
+static void timer_heap_set(uint8_t pos, sTimer* timer)
+{
+  s_heap[pos] = timer;
+  timer->heap_pos = pos + 1;
+}
+
+static void timer_heap_sift_up(uint8_t pos)
+{
+  sTimer* timer = s_heap[pos];
+  while (pos > 0)
+  {
+    uint8_t parent = (pos - 1) / 2;
+    if (!timer_before(timer, s_heap[parent]))
+      break;
+    timer_heap_set(pos, s_heap[parent]);
+    pos = parent;
+  }
+  timer_heap_set(pos, timer);
+}
+
+static void timer_heap_sift_down(uint8_t pos)
+{
+  sTimer* timer = s_heap[pos];
+  for (;;)
+  {
+    uint8_t child = 2 * pos + 1;
+    if (child >= s_heap_count)
+      break;
+    if (child + 1 < s_heap_count && timer_before(s_heap[child + 1], s_heap[child]))
+      child++;
+    if (!timer_before(s_heap[child], timer))
+      break;
+    timer_heap_set(pos, s_heap[child]);
+    pos = child;
+  }
+  timer_heap_set(pos, timer);
+}
+
+static void timer_heap_remove(sTimer* timer)
+{
+  if (timer->heap_pos == 0)
+    return;
+
+  uint8_t pos = timer->heap_pos - 1;
+  sTimer* last = s_heap[--s_heap_count];
+  timer->heap_pos = 0;
+
+  if (last != timer)
+  {
+    timer_heap_set(pos, last);
+    timer_heap_sift_up(pos);
+    timer_heap_sift_down(last->heap_pos - 1);
   }
 }
 
+// timer_alloc() hands out at most TIMER_MAX_RUNNING timers, a pushed timer
+// always has a slot
+static void timer_heap_push(sTimer* timer)
+{
+  timer_heap_set(s_heap_count, timer);
+  timer_heap_sift_up(s_heap_count++);
+}
+
+static void timer_dispatch(void* context);
+
+// Arm the shared AppTimer. Deadlines within TIMER_COALESCE_MS of the earliest
+// one are served by the same wakeup, so the earliest timer shows its time up
+// to TIMER_COALESCE_MS late. The first deadlines of two wakeups are more than
+// TIMER_COALESCE_MS apart: timers ticking every TIMER_TICK_MS wake the app at
+// most twice per tick, however many run and whatever their phases, against
+// once for a single timer. Being late never drifts as time comes from the
+// clock.
+static void timer_wakeup_schedule(void)
+{
+  if (s_dispatching)
+    return;
+
+  if (s_heap_count == 0)
+  {
+    app_timer_cancel_safe(s_wakeup);
+    return;
+  }
+
+  uint32_t wakeup_ms = s_heap[0]->deadline_ms;
+  for (uint8_t i = 1; i < s_heap_count; i++)
+  {
+    int32_t diff = (int32_t)(s_heap[i]->deadline_ms - s_heap[0]->deadline_ms);
+    if (diff <= TIMER_COALESCE_MS && (int32_t)(s_heap[i]->deadline_ms - wakeup_ms) > 0)
+      wakeup_ms = s_heap[i]->deadline_ms;
+  }
+
+  int32_t delay = (int32_t)(wakeup_ms - timer_now_ms());
+  if (delay < 0)
+    delay = 0;
+
+  if (s_wakeup == NULL || !app_timer_reschedule(s_wakeup, delay))
+    s_wakeup = app_timer_register(delay, timer_dispatch, NULL);
+}
+
+static void timer_dispatch(void* context)
+{
+  DEBUG("%s\n",__func__);
+  uint32_t now = timer_now_ms();
+
+  s_wakeup = NULL;
+  timer_count_wakeup(now);
+
+  // ticks may start, stop or reschedule timers, the AppTimer is armed after
+  s_dispatching = true;
+  while (s_heap_count > 0 && (int32_t)(s_heap[0]->deadline_ms - now) <= 0)
+  {
+    sTimer* timer = s_heap[0];
+    timer_heap_remove(timer);
+    PERF_START(PERF_TIMER_TICK);
+    timer_tick(timer);
+    PERF_STOP(PERF_TIMER_TICK);
+  }
+  s_dispatching = false;
+
+  // one vibration for all alerts of this wakeup
+  haptic_flush(now);
+
+  timer_wakeup_schedule();
+}
+
+static void timer_tick(sTimer* timer)
+{
+  DEBUG("%s\n",__func__);
+  uint32_t now = timer_now_ms();
+  uint32_t elapsed = timer_elapsed_ms(timer, now) / TIMER_TICK_MS;
+
+  TRACE(TRACE_TICK, (now - timer->deadline_ms > UINT8_MAX) ? UINT8_MAX : now - timer->deadline_ms);
+
+  timer_update_time(timer, now);
+
+  if (timer->type == TIMER_TYPE_TIMER && timer->current_time == 0)
+  {
+    timer_finish(timer);
+    return;
+  }
+
+  // alerts missed by a late tick are given once
+  if (elapsed >= timer->next_alert)
+  {
+    haptic_request(timer->next_alert_type, TIMER_VIBE_SHORT);
+    timer_alert_seek(timer, elapsed);
+  }
+
+  timer_schedule_tick(timer);
+  timer_callback_update(timer);
+}
+
 
 static void timer_finish(sTimer* timer) {
   DEBUG("%s\n",__func__);
+  // the timer ends on its length, however late the tick that saw it
+  timer->elapsed_ms = timer->length * TIMER_TICK_MS;
   timer->status = TIMER_STATUS_DONE;
   timer_cancel_tick(timer);
   timer_completed_action(timer);
@@ -126,59 +477,38 @@ static void timer_finish(sTimer* timer) {
 
 static void timer_schedule_tick(sTimer* timer) {
   DEBUG("%s\n",__func__);
-  timer->timer = app_timer_register(100, timer_tick, (void*)timer);  // 0.1 timer
+  // sleep until the next deadline, on an exact tick boundary
+  uint32_t elapsed = timer_elapsed_ms(timer, timer_now_ms());
+  uint32_t next = timer_next_deadline(timer, elapsed / TIMER_TICK_MS);
+
+  timer_heap_remove(timer);
+  timer->deadline_ms = timer->start_ms + next * TIMER_TICK_MS;
+  timer_heap_push(timer);
+  timer_wakeup_schedule();
 }
 
 static void timer_cancel_tick(sTimer* timer) {
   DEBUG("%s\n",__func__);
-  if (timer->timer) {
-    app_timer_cancel(timer->timer);
-    timer->timer = NULL;
+  if (timer->heap_pos) {
+    timer_heap_remove(timer);
+    timer_wakeup_schedule();
   }
 }
 
 static void timer_completed_action(sTimer* timer) {
   DEBUG("%s\n",__func__);
-  switch (timer->expired_vibration) {
-    case TIMER_VIBE_NONE:
-      // Do nothing!
-      break;
-    case TIMER_VIBE_SHORT:
-      vibes_short_pulse();
-      break;
-    case TIMER_VIBE_LONG:
-      vibes_long_pulse();
-      break;
-    case TIMER_VIBE_DOUBLE: {
-      const uint32_t seg[] = { 600, 200, 600 };
-      VibePattern pattern = {
-        .durations =  seg,
-        .num_segments = ARRAY_LENGTH(seg)
-      };
-      vibes_enqueue_custom_pattern(pattern);
-      break;
-    }
-    case TIMER_VIBE_TRIPLE: {
-      const uint32_t seg[] = { 600, 200, 600, 200, 600 };
-      VibePattern pattern = {
-        .durations =  seg,
-        .num_segments = ARRAY_LENGTH(seg)
-      };
-      vibes_enqueue_custom_pattern(pattern);
-      break;
-    }
-    default:
-      break;
-  }
+  haptic_request(HAPTIC_EXPIRED, timer->expired_vibration);
 }
 
 
 static void timer_callback_update(sTimer* timer)
 {
-  DEBUG("%s %X\n",__func__, (unsigned int)timer->update_cb.handler);
+  DEBUG("%s %p\n",__func__, (void*)timer->update_cb.handler);
   if (timer->update_cb.handler != NULL )
   {
+    PERF_START(PERF_UPDATE_CB);
     timer->update_cb.handler(timer->update_cb.context);
+    PERF_STOP(PERF_UPDATE_CB);
   }
 }
 
@@ -192,13 +522,67 @@ static void timer_callback_done(sTimer* timer)
 }
 
 
+/******************************************************************************
+  Timer allocation
+******************************************************************************/
+static sTimer* timer_alloc(void)
+{
+  if (s_pool_used >= TIMER_MAX_RUNNING)
+    return NULL;
+
+#if TIMER_POOL_SIZE > 0
+  if (!s_pool_ready)
+  {
+    for (uint8_t i = 0; i < TIMER_POOL_SIZE; i++)
+    {
+      s_pool_next[i] = (i + 1 < TIMER_POOL_SIZE) ? i + 1 : TIMER_POOL_NONE;
+    }
+    s_pool_free = 0;
+    s_pool_ready = true;
+  }
+
+  if (s_pool_free == TIMER_POOL_NONE)
+    return NULL;
+
+  sTimer* t = &s_pool[s_pool_free];
+  s_pool_free = s_pool_next[s_pool_free];
+#else
+  sTimer* t = malloc(sizeof(sTimer));
+  if (t == NULL)
+    return NULL;
+#endif
+
+  if (++s_pool_used > s_pool_peak)
+    s_pool_peak = s_pool_used;
+
+  memset((void*)t, 0, sizeof(sTimer));
+  return t;
+}
+
+static void timer_free(sTimer* t)
+{
+#if TIMER_POOL_SIZE > 0
+  uint8_t slot = t - s_pool;
+  s_pool_next[slot] = s_pool_free;
+  s_pool_free = slot;
+#else
+  free(t);
+#endif
+  s_pool_used--;
+}
+
 /******************************************************************************
   Timer creator
 ******************************************************************************/
 Timer timer_create(void) {
   DEBUG("%s\n",__func__);
-  sTimer* t = malloc(sizeof(sTimer));
-  memset((void*)t,sizeof(sTimer),0);
+  HEAP_CHECK_START();
+  sTimer* t = timer_alloc();
+  if (t == NULL) {
+    ERROR("Timer alloc failed");
+  }
+  DEBUG("Timers used %d peak %d pool %d", s_pool_used, s_pool_peak, TIMER_POOL_SIZE);
+  HEAP_CHECK_STOP();
   return (Timer)t;
 }
 
@@ -207,13 +591,14 @@ void timer_destroy(Timer timer)
   if(timer != NULL)
   {
     DEBUG("%s\n",__func__);
+    HEAP_CHECK_START();
 
-    sTimer *t = (sTimer*)timer;
-    if (t->timer) {
-      app_timer_cancel(t->timer);
-    }
-    free(timer);
+    timer_cancel_tick((sTimer*)timer);
+    timer_free((sTimer*)timer);
     timer = NULL;
+
+    DEBUG("Timers used %d peak %d pool %d", s_pool_used, s_pool_peak, TIMER_POOL_SIZE);
+    HEAP_CHECK_STOP();
   }
 }
 
@@ -229,6 +614,13 @@ void timer_start(Timer timer)
 
   sTimer *t = (sTimer*)timer;
   timer_cancel_tick(t);
+  if (t->status != TIMER_STATUS_RUNNING)
+  {
+    // continue from the elapsed time, which is 0 after a reset
+    t->start_ms = timer_now_ms() - t->elapsed_ms;
+    timer_alert_compile(t);
+    timer_alert_seek(t, t->elapsed_ms / TIMER_TICK_MS);
+  }
   t->status = TIMER_STATUS_RUNNING;
   timer_schedule_tick(t);
 }
@@ -243,6 +635,10 @@ void timer_pause(Timer timer)
 
   sTimer *t = (sTimer*)timer;
   timer_cancel_tick(t);
+  if (t->status == TIMER_STATUS_RUNNING)
+  {
+    t->elapsed_ms = timer_now_ms() - t->start_ms;
+  }
   t->status = TIMER_STATUS_PAUSED;
 }
 
@@ -259,8 +655,11 @@ void timer_resume(Timer timer)
     t->status = TIMER_STATUS_STOPPED;
     timer_cancel_tick(t);
   }
-  else
+  else if (t->status != TIMER_STATUS_RUNNING)
   {
+    t->start_ms = timer_now_ms() - t->elapsed_ms;
+    timer_alert_compile(t);
+    timer_alert_seek(t, t->elapsed_ms / TIMER_TICK_MS);
     t->status = TIMER_STATUS_RUNNING;
     timer_schedule_tick(t);
   }
@@ -275,6 +674,7 @@ void timer_stop(Timer timer)
 
   sTimer* t = (sTimer*)timer;
   timer_cancel_tick(t);
+  t->elapsed_ms = timer_elapsed_ms(t, timer_now_ms());
   t->status = TIMER_STATUS_STOPPED;
 }
 
@@ -290,6 +690,32 @@ void timer_reset(Timer timer)
   return;
 }
 
+/******************************************************************************
+  Continue from an elapsed time, used to restore a timer after a relaunch.
+  The new time is shown at once, a running timer takes its next tick on the
+  boundary of it.
+******************************************************************************/
+void timer_set_elapsed_ms(Timer timer, uint32_t elapsed_ms)
+{
+  if(timer==NULL)
+    return;
+
+  DEBUG("%s\n",__func__);
+
+  sTimer* t = (sTimer*)timer;
+  uint32_t now = timer_now_ms();
+  t->elapsed_ms = elapsed_ms;
+  t->start_ms = now - elapsed_ms;
+  timer_update_time(t, now);
+  timer_alert_compile(t);
+  timer_alert_seek(t, elapsed_ms / TIMER_TICK_MS);
+  if (t->status == TIMER_STATUS_RUNNING)
+  {
+    timer_schedule_tick(t);
+  }
+  timer_callback_update(t);
+}
+
 /******************************************************************************
  Set Timer length
 ******************************************************************************/
@@ -338,6 +764,32 @@ uint32_t timer_get_time(Timer timer)
   DEBUG("%s\n",__func__);
   return ((sTimer*)timer)->current_time;
 }
+
+/******************************************************************************
+  Get elapsed time in ms, read from the clock and not rounded to a tick
+******************************************************************************/
+uint32_t timer_get_elapsed_ms(Timer timer)
+{
+  if(timer==NULL)
+    return 0;
+
+  return timer_elapsed_ms((sTimer*)timer, timer_now_ms());
+}
+
+/******************************************************************************
+  Time since a timer expired, 0 if it has not. What follows an expired timer
+  starts that much into its own time, so a late expiry does not delay it.
+******************************************************************************/
+uint32_t timer_get_overrun_ms(Timer timer)
+{
+  if(timer==NULL)
+    return 0;
+
+  sTimer* t = (sTimer*)timer;
+  if (t->status != TIMER_STATUS_DONE)
+    return 0;
+  return timer_now_ms() - t->start_ms - t->elapsed_ms;
+}
 /******************************************************************************
   Set timer expire warning length
 ******************************************************************************/
@@ -368,7 +820,28 @@ void timer_set_interval_vibration(Timer timer, uint32_t interval)
   sTimer* t = (sTimer*)timer;
   if(t->status == TIMER_STATUS_STOPPED)
   {
-    t->vib_interval = t->vib_interval_counter = interval * TIMER_RESOLUTION; // counter at 10 ms resolution
+    t->vib_interval = interval * TIMER_RESOLUTION; // at 10 ms resolution
+  }
+}
+
+/******************************************************************************
+  Set alert points, in sec of the displayed time. Counting down they are
+  the remaining time, 0 points are unused.
+******************************************************************************/
+void timer_set_alert_points(Timer timer, const uint16_t* points, uint8_t count)
+{
+  if(timer==NULL)
+    return;
+
+  DEBUG("%s\n",__func__);
+
+  sTimer* t = (sTimer*)timer;
+  if(t->status == TIMER_STATUS_STOPPED)
+  {
+    memset(t->alert_points, 0, sizeof(t->alert_points));
+    if (count > TIMER_MAX_ALERT_POINTS)
+      count = TIMER_MAX_ALERT_POINTS;
+    memcpy(t->alert_points, points, count * sizeof(uint16_t));
   }
 }
 
@@ -386,6 +859,23 @@ void timer_set_expired_vibration(Timer timer, TimerVibration vib)
   }
 }
 
+/******************************************************************************
+  Set display resolution
+******************************************************************************/
+void timer_set_display_resolution(Timer timer, TimerResolution res)
+{
+  if(timer==NULL)
+    return;
+
+  DEBUG("%s\n",__func__);
+
+  sTimer* t = (sTimer*)timer;
+  if(t->status == TIMER_STATUS_STOPPED)
+  {
+    t->display_step = (res == TIMER_RES_SECOND) ? TIMER_RESOLUTION : 1;
+  }
+}
+
 /******************************************************************************
   register callbacks
 ******************************************************************************/
@@ -443,24 +933,117 @@ char* timer_vibe_str(TimerVibration vibe, bool shortStr) {
   return "";
 }
 
-void timer_time_str(uint32_t timer_time, char* str, int str_len) {
+char* timer_resolution_str(TimerResolution res) {
+  switch (res) {
+    case TIMER_RES_TENTH:
+      return "0.1 sec";
+    case TIMER_RES_SECOND:
+      return "1 sec";
+    case TIMER_RES_MAX:
+      return "";
+  }
+  return "";
+}
+
+/******************************************************************************
+  Time formatting
 
-  int seconds = timer_time % 60;
-  int minutes = timer_time / 60;
+  Runs on every tick and every settings row draw, so it avoids snprintf: the
+  time is split with as few divisions as possible and two digit groups come
+  from a lookup table. Output is the same as the former snprintf formats.
+******************************************************************************/
+static const char DIGIT_PAIRS[] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+// At least two characters, values below 10 are padded with pad, 0 for no padding
+static char* timer_format_number(char* p, uint32_t value, char pad)
+{
+  if (value >= 100)
+  {
+    p = timer_format_number(p, value / 100, 0);
+    value %= 100;
+    pad = '0';
+  }
+
+  const char *digits = &DIGIT_PAIRS[value * 2];
+  if (value >= 10 || pad == '0')
+    *p++ = digits[0];
+  else if (pad)
+    *p++ = pad;
+  *p++ = digits[1];
+  return p;
+}
+
+// Copies into the caller's buffer, cut to fit, returns the length
+static uint8_t timer_format_copy(const char* buf, uint8_t len, char* str, int str_len)
+{
+  if (str_len <= 0)
+    return 0;
+  if (len > str_len - 1)
+    len = str_len - 1;
 
-  snprintf(str, str_len, "%02d:%02d", minutes, seconds);
+  memcpy(str, buf, len);
+  str[len] = '\0';
+  return len;
 }
 
-void timer_time_str_ms(uint32_t timer_time, bool ShowMinutes, char* str, int str_len) {
+uint8_t timer_time_format(uint32_t timer_time, bool ShowMinutes, TimerResolution res, char* str, int str_len)
+{
+  char buf[16];
+  char *p = buf;
 
-  int millisec = timer_time % TIMER_RESOLUTION;
-  int seconds = (timer_time / TIMER_RESOLUTION) % 60;
-  int minutes = timer_time / (60 * TIMER_RESOLUTION);
+  uint32_t seconds = timer_time / TIMER_RESOLUTION;
+  uint8_t tenths = timer_time - seconds * TIMER_RESOLUTION;
+  uint32_t minutes = seconds / 60;
+  seconds -= minutes * 60;
 
   if (ShowMinutes)
-    snprintf(str, str_len, "%2d:%02d.%01d", minutes, seconds, millisec);
+  {
+    p = timer_format_number(p, minutes, ' ');
+    *p++ = ':';
+    p = timer_format_number(p, seconds, '0');
+  }
   else
-    snprintf(str, str_len, "%2d.%01d", seconds, millisec);
+    p = timer_format_number(p, seconds, ' ');
+
+  if (res != TIMER_RES_SECOND)
+  {
+    *p++ = '.';
+    *p++ = '0' + tenths;
+  }
+  return timer_format_copy(buf, p - buf, str, str_len);
+}
+
+void timer_time_str(uint32_t timer_time, char* str, int str_len) {
+  char buf[16];
+  char *p = buf;
+
+  uint32_t minutes = timer_time / 60;
+  p = timer_format_number(p, minutes, '0');
+  *p++ = ':';
+  p = timer_format_number(p, timer_time - minutes * 60, '0');
+  timer_format_copy(buf, p - buf, str, str_len);
+}
+
+void timer_time_str_ms(uint32_t timer_time, bool ShowMinutes, TimerResolution res, char* str, int str_len) {
+  timer_time_format(timer_time, ShowMinutes, res, str, str_len);
+}
+
+/******************************************************************************
+  Debug
+******************************************************************************/
+uint32_t timer_debug_wakeups_per_minute(void)
+{
+  return s_wakeups_last_minute;
 }
 
 
@@ -42,6 +42,12 @@ typedef enum {
   TIMER_VIBE_MAX,
 } TimerVibration;
 
+typedef enum {
+  TIMER_RES_TENTH,
+  TIMER_RES_SECOND,
+  TIMER_RES_MAX,
+} TimerResolution;
+
 typedef enum {
   TIMER_STATUS_STOPPED = 0,
   TIMER_STATUS_RUNNING = 1,
@@ -61,8 +67,10 @@ typedef void* (Timer);
 
 #define TIMER_REPEAT_INFINITE 100
 
+#define TIMER_MAX_ALERT_POINTS 8
+
 
-// Timer creator
+// Timer creator, NULL when all timers are in use
 Timer timer_create(void);
 void timer_destroy(Timer timer);
 
@@ -71,10 +79,13 @@ void timer_start(Timer timer);
 void timer_pause(Timer timer);
 void timer_resume(Timer timer);
 void timer_reset(Timer timer);
+void timer_set_elapsed_ms(Timer timer, uint32_t elapsed_ms);
 
 // Get timer info
 TimerStatus timer_get_status(Timer timer);
 uint32_t    timer_get_time(Timer timer);
+uint32_t    timer_get_elapsed_ms(Timer timer);
+uint32_t    timer_get_overrun_ms(Timer timer);
 uint32_t    timer_get_resolution(Timer timer);
 
 // Set Timer length
@@ -86,6 +97,10 @@ void timer_set_before_expire_warning_length(Timer timer, uint32_t length);
 // Set timer vibration
 void timer_set_interval_vibration(Timer timer, uint32_t interval);
 void timer_set_expired_vibration(Timer timer, TimerVibration vib);
+void timer_set_alert_points(Timer timer, const uint16_t* points, uint8_t count);
+
+// Set how often the time shown to the user changes
+void timer_set_display_resolution(Timer timer, TimerResolution res);
 
 // register callbacks
 void timer_register_expired_cb(Timer timer, TimerCbHandler callback, void *context);
@@ -93,5 +108,10 @@ void timer_register_update_cb(Timer timer, TimerCbHandler callback, void *contex
 
 // String help functions
 char* timer_vibe_str(TimerVibration vibe, bool shortStr);
+char* timer_resolution_str(TimerResolution res);
 void timer_time_str(uint32_t timer_time, char* str, int str_len);
-void timer_time_str_ms(uint32_t timer_time, bool ShowMinutes, char* str, int str_len);
+void timer_time_str_ms(uint32_t timer_time, bool ShowMinutes, TimerResolution res, char* str, int str_len);
+uint8_t timer_time_format(uint32_t timer_time, bool ShowMinutes, TimerResolution res, char* str, int str_len);
+
+// Debug
+uint32_t timer_debug_wakeups_per_minute(void);
@@ -0,0 +1,86 @@
+#include <pebble.h>
+#include <utils/pebble-assist.h>
+#include "trace.h"
+
+#if TRACE_SIZE > 0
+
+#define TRACE_DUMP_PER_LINE 16
+
+static trace_record_t s_trace[TRACE_SIZE];
+static uint16_t s_trace_next = 0;
+static uint16_t s_trace_count = 0;
+static uint32_t s_trace_last_ms = 0;
+
+// time of the oldest record kept
+static uint32_t s_trace_first_sec = 0;
+static uint16_t s_trace_first_ms = 0;
+
+void trace_record(trace_type_t type, uint8_t arg)
+{
+  time_t seconds;
+  uint16_t millis = time_ms(&seconds, NULL);
+  uint32_t now = (uint32_t)seconds * 1000 + millis;
+  uint32_t dt = now - s_trace_last_ms;
+
+  if (s_trace_count == 0)
+  {
+    s_trace_first_sec = seconds;
+    s_trace_first_ms = millis;
+    dt = 0;
+  }
+  else if (s_trace_count == TRACE_SIZE)
+  {
+    // the oldest record is overwritten, the one after it is the first
+    uint32_t first_ms = s_trace_first_ms + s_trace[(s_trace_next + 1) % TRACE_SIZE].dt_ms;
+    s_trace_first_sec += first_ms / 1000;
+    s_trace_first_ms = first_ms % 1000;
+  }
+  s_trace_last_ms = now;
+
+  trace_record_t *record = &s_trace[s_trace_next];
+  record->dt_ms = (dt > UINT16_MAX) ? UINT16_MAX : dt;
+  record->type = type;
+  record->arg = arg;
+
+  s_trace_next = (s_trace_next + 1) % TRACE_SIZE;
+  if (s_trace_count < TRACE_SIZE)
+    s_trace_count++;
+}
+
+void trace_clear(void)
+{
+  s_trace_next = 0;
+  s_trace_count = 0;
+}
+
+// Oldest record first, as hex of the raw records. Written with APP_LOG, so
+// it is available with logging disabled. The start is the time of the first
+// record, its dt is 0.
+void trace_dump(void)
+{
+  char line[TRACE_DUMP_PER_LINE * sizeof(trace_record_t) * 2 + 1];
+  uint16_t index = (s_trace_next + TRACE_SIZE - s_trace_count) % TRACE_SIZE;
+
+  APP_LOG(APP_LOG_LEVEL_INFO, "TRACE start %u.%03u records %u",
+          (unsigned)s_trace_first_sec, (unsigned)s_trace_first_ms, (unsigned)s_trace_count);
+  for (uint16_t done = 0; done < s_trace_count; )
+  {
+    char *p = line;
+    for (uint8_t i = 0; i < TRACE_DUMP_PER_LINE && done < s_trace_count; i++, done++)
+    {
+      trace_record_t record = s_trace[index];
+      if (done == 0)
+        record.dt_ms = 0;
+      const uint8_t *bytes = (const uint8_t *)&record;
+      for (uint8_t b = 0; b < sizeof(trace_record_t); b++)
+      {
+        p += snprintf(p, 3, "%02x", bytes[b]);
+      }
+      index = (index + 1) % TRACE_SIZE;
+    }
+    APP_LOG(APP_LOG_LEVEL_INFO, "TRACE %s", line);
+  }
+  APP_LOG(APP_LOG_LEVEL_INFO, "TRACE end");
+}
+
+#endif
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <pebble.h>
+
+// Records kept in the trace ring buffer, 0 compiles the trace out
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 0
+#endif
+
+typedef enum {
+  TRACE_EVENT,      // arg: racetimer event | clicks << 4
+  TRACE_STATE,      // arg: new racetimer state
+  TRACE_TICK,       // arg: wakeup lateness, ms
+  TRACE_VIBE,       // arg: haptic alert << 4 | vibration
+} trace_type_t;
+
+// 4 bytes per record, time is relative to the previous record. A gap of
+// more than 65 s is kept as 65535 ms.
+typedef struct __attribute__((__packed__)) {
+  uint16_t dt_ms;
+  uint8_t  type;
+  uint8_t  arg;
+} trace_record_t;
+
+#if TRACE_SIZE > 0
+void trace_record(trace_type_t type, uint8_t arg);
+void trace_clear(void);
+void trace_dump(void);
+#define TRACE(type, arg) trace_record(type, arg)
+#else
+#define TRACE(type, arg)
+#define trace_clear()
+#define trace_dump()
+#endif
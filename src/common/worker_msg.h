@@ -0,0 +1,19 @@
+#pragma once
+
+// Shared between the app and the background worker
+
+// Heat handed over to the worker when the app is closed mid-heat
+#define WORKER_HEAT_KEY 150
+
+#define WORKER_MAX_LAUNCHES 8
+
+typedef struct {
+  uint32_t launch[WORKER_MAX_LAUNCHES];   // wall clock, sec, 0 if passed or none
+} worker_heat_t;
+
+// AppWorkerMessage types, app to worker. The worker runs from the first
+// time the app is closed mid-heat until it is closed without one.
+typedef enum {
+  WORKER_MSG_HEAT_CHANGED = 1,  // reload WORKER_HEAT_KEY
+  WORKER_MSG_HEAT_STOP,         // forget the heat, the app is open
+} worker_msg_t;
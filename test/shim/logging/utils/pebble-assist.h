@@ -0,0 +1,26 @@
+#pragma once
+
+// pebble-assist with logging compiled in, for the build of the app that
+// checks the log calls. The include path puts this before the real one.
+
+#include_next <utils/pebble-assist.h>
+
+#undef DISABLE_LOGGING
+#define DISABLE_LOGGING false
+
+#undef LOG
+#undef DEBUG
+#undef INFO
+#undef WARN
+#undef ERROR
+#define LOG(...) app_log(APP_LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+#define DEBUG(...) app_log(APP_LOG_LEVEL_DEBUG, __FILE__, __LINE__, __VA_ARGS__)
+#define INFO(...) app_log(APP_LOG_LEVEL_INFO, __FILE__, __LINE__, __VA_ARGS__)
+#define WARN(...) app_log(APP_LOG_LEVEL_WARNING, __FILE__, __LINE__, __VA_ARGS__)
+#define ERROR(...) app_log(APP_LOG_LEVEL_ERROR, __FILE__, __LINE__, __VA_ARGS__)
+
+// heap_bytes_free() is a size_t, the casts keep the formats right on the host
+#undef HEAP_CHECK_START
+#undef HEAP_CHECK_STOP
+#define HEAP_CHECK_START()  uint32_t __heap__ = heap_bytes_free(); DEBUG("HEAP_CHECK_START %d", (int)heap_bytes_free());
+#define HEAP_CHECK_STOP()   DEBUG("HEAP_CHECK_STOP %d %d", (int)heap_bytes_free(), (int)(__heap__ - heap_bytes_free()));
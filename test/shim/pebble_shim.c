@@ -0,0 +1,1370 @@
+#include <stdarg.h>
+#include "pebble_shim.h"
+#include <utils/bitmap-loader.h>
+#include <utils/scroll-text-layer.h>
+
+/******************************************************************************
+  Virtual clock
+******************************************************************************/
+static uint64_t s_now_ms = 1700000000000ULL;
+
+uint64_t shim_now_ms(void)
+{
+  return s_now_ms;
+}
+
+void shim_set_now_ms(uint64_t now_ms)
+{
+  s_now_ms = now_ms;
+}
+
+time_t shim_time(time_t *tloc)
+{
+  time_t seconds = (time_t)(s_now_ms / 1000);
+  if (tloc)
+    *tloc = seconds;
+  return seconds;
+}
+
+uint16_t time_ms(time_t *tloc, uint16_t *out_ms)
+{
+  uint16_t millis = s_now_ms % 1000;
+  shim_time(tloc);
+  if (out_ms)
+    *out_ms = millis;
+  return millis;
+}
+
+/******************************************************************************
+  Logging
+******************************************************************************/
+static char s_last_log[256];
+static uint32_t s_log_count = 0;
+static ShimLogHandler s_log_handler = NULL;
+
+void app_log(uint8_t log_level, const char *src_filename, int src_line_number, const char *fmt, ...)
+{
+  va_list args;
+  va_start(args, fmt);
+  vsnprintf(s_last_log, sizeof(s_last_log), fmt, args);
+  va_end(args);
+  s_log_count++;
+  if (getenv("SHIM_LOG"))
+    fprintf(stderr, "[%d] %s:%d %s\n", log_level, src_filename, src_line_number, s_last_log);
+  if (s_log_handler)
+    s_log_handler(s_last_log);
+}
+
+const char* shim_last_log(void)
+{
+  return s_last_log;
+}
+
+uint32_t shim_log_count(void)
+{
+  return s_log_count;
+}
+
+void shim_set_log_handler(ShimLogHandler handler)
+{
+  s_log_handler = handler;
+}
+
+size_t heap_bytes_free(void)
+{
+  return 0;
+}
+
+/******************************************************************************
+  App timers
+
+  Due times are kept on the virtual clock, timers due at the same time run
+  in the order they were registered.
+******************************************************************************/
+#define SHIM_MAX_TIMERS 32
+
+struct AppTimer {
+  bool              used;
+  uint64_t          due_ms;
+  uint32_t          seq;
+  AppTimerCallback  callback;
+  void             *data;
+};
+
+static struct AppTimer s_timers[SHIM_MAX_TIMERS];
+static uint32_t s_timer_seq = 0;
+static uint32_t s_wakeups = 0;
+static uint32_t s_jitter_ms = 0;
+static unsigned int s_jitter_seed = 1;
+
+void shim_set_jitter(uint32_t max_late_ms, unsigned int seed)
+{
+  s_jitter_ms = max_late_ms;
+  s_jitter_seed = seed ? seed : 1;
+}
+
+static uint32_t shim_jitter(void)
+{
+  if (s_jitter_ms == 0)
+    return 0;
+  s_jitter_seed = s_jitter_seed * 1103515245u + 12345u;
+  return (s_jitter_seed >> 16) % (s_jitter_ms + 1);
+}
+
+static void shim_timer_arm(AppTimer *timer, uint32_t timeout_ms)
+{
+  timer->due_ms = s_now_ms + timeout_ms + shim_jitter();
+  timer->seq = s_timer_seq++;
+}
+
+AppTimer* app_timer_register(uint32_t timeout_ms, AppTimerCallback callback, void *callback_data)
+{
+  for (uint8_t i = 0; i < SHIM_MAX_TIMERS; i++)
+  {
+    AppTimer *timer = &s_timers[i];
+    if (!timer->used)
+    {
+      timer->used = true;
+      timer->callback = callback;
+      timer->data = callback_data;
+      shim_timer_arm(timer, timeout_ms);
+      return timer;
+    }
+  }
+  fprintf(stderr, "shim: out of app timers\n");
+  abort();
+}
+
+bool app_timer_reschedule(AppTimer *timer_handle, uint32_t new_timeout_ms)
+{
+  if (timer_handle == NULL || !timer_handle->used)
+    return false;
+  shim_timer_arm(timer_handle, new_timeout_ms);
+  return true;
+}
+
+void app_timer_cancel(AppTimer *timer_handle)
+{
+  if (timer_handle)
+    timer_handle->used = false;
+}
+
+uint32_t shim_wakeups(void)
+{
+  return s_wakeups;
+}
+
+uint8_t shim_timers_pending(void)
+{
+  uint8_t count = 0;
+  for (uint8_t i = 0; i < SHIM_MAX_TIMERS; i++)
+  {
+    if (s_timers[i].used)
+      count++;
+  }
+  return count;
+}
+
+/******************************************************************************
+  Tick timer service
+******************************************************************************/
+static TickHandler s_tick_handler = NULL;
+static TimeUnits s_tick_units = 0;
+static uint64_t s_tick_next_ms = 0;
+
+static uint64_t shim_tick_period_ms(void)
+{
+  return (s_tick_units & SECOND_UNIT) ? 1000 : 60000;
+}
+
+void tick_timer_service_subscribe(TimeUnits tick_units, TickHandler handler)
+{
+  uint64_t period;
+
+  s_tick_handler = handler;
+  s_tick_units = tick_units;
+  period = shim_tick_period_ms();
+  s_tick_next_ms = (s_now_ms / period + 1) * period;
+}
+
+void tick_timer_service_unsubscribe(void)
+{
+  s_tick_handler = NULL;
+}
+
+static void shim_tick_fire(void)
+{
+  time_t now = (time_t)(s_now_ms / 1000);
+  struct tm *tick_time = localtime(&now);
+  TimeUnits units = SECOND_UNIT;
+
+  if (tick_time->tm_sec == 0)
+    units |= MINUTE_UNIT;
+  s_tick_next_ms += shim_tick_period_ms();
+  if (units & s_tick_units)
+    s_tick_handler(tick_time, units);
+}
+
+/******************************************************************************
+  Running the clock
+******************************************************************************/
+void shim_run_until(uint64_t until_ms)
+{
+  for (;;)
+  {
+    AppTimer *next = NULL;
+    for (uint8_t i = 0; i < SHIM_MAX_TIMERS; i++)
+    {
+      AppTimer *timer = &s_timers[i];
+      if (timer->used && (next == NULL || timer->due_ms < next->due_ms ||
+                          (timer->due_ms == next->due_ms && timer->seq < next->seq)))
+        next = timer;
+    }
+
+    bool tick = s_tick_handler && s_tick_next_ms <= until_ms &&
+                (next == NULL || s_tick_next_ms < next->due_ms);
+
+    if (tick)
+    {
+      if (s_tick_next_ms > s_now_ms)
+        s_now_ms = s_tick_next_ms;
+      shim_tick_fire();
+    }
+    else if (next && next->due_ms <= until_ms)
+    {
+      if (next->due_ms > s_now_ms)
+        s_now_ms = next->due_ms;
+      next->used = false;
+      s_wakeups++;
+      next->callback(next->data);
+    }
+    else
+      break;
+  }
+  if (until_ms > s_now_ms)
+    s_now_ms = until_ms;
+}
+
+void shim_run_for(uint32_t ms)
+{
+  shim_run_until(s_now_ms + ms);
+}
+
+void app_event_loop(void)
+{
+}
+
+/******************************************************************************
+  Vibes
+******************************************************************************/
+#define SHIM_MAX_VIBES 1024
+
+static ShimVibe s_vibes[SHIM_MAX_VIBES];
+static uint32_t s_vibe_count = 0;
+
+static void shim_vibe_add(ShimVibeKind kind, const uint32_t *durations, uint32_t num_segments)
+{
+  if (s_vibe_count >= SHIM_MAX_VIBES)
+    return;
+
+  ShimVibe *vibe = &s_vibes[s_vibe_count++];
+  vibe->at_ms = s_now_ms;
+  vibe->kind = kind;
+  if (num_segments > SHIM_VIBE_MAX_SEGMENTS)
+    num_segments = SHIM_VIBE_MAX_SEGMENTS;
+  vibe->num_segments = num_segments;
+  for (uint32_t i = 0; i < num_segments; i++)
+    vibe->durations[i] = durations[i];
+}
+
+void vibes_short_pulse(void)
+{
+  shim_vibe_add(SHIM_VIBE_SHORT, NULL, 0);
+}
+
+void vibes_long_pulse(void)
+{
+  shim_vibe_add(SHIM_VIBE_LONG, NULL, 0);
+}
+
+void vibes_double_pulse(void)
+{
+  shim_vibe_add(SHIM_VIBE_DOUBLE, NULL, 0);
+}
+
+void vibes_cancel(void)
+{
+  shim_vibe_add(SHIM_VIBE_CANCEL, NULL, 0);
+}
+
+void vibes_enqueue_custom_pattern(VibePattern pattern)
+{
+  shim_vibe_add(SHIM_VIBE_PATTERN, pattern.durations, pattern.num_segments);
+}
+
+uint32_t shim_vibes_count(void)
+{
+  return s_vibe_count;
+}
+
+const ShimVibe* shim_vibe(uint32_t index)
+{
+  return (index < s_vibe_count) ? &s_vibes[index] : NULL;
+}
+
+void shim_vibes_clear(void)
+{
+  s_vibe_count = 0;
+}
+
+/******************************************************************************
+  Storage
+******************************************************************************/
+#define SHIM_MAX_KEYS 512
+
+typedef struct {
+  bool      used;
+  uint32_t  key;
+  uint16_t  size;
+  uint8_t   data[PERSIST_DATA_MAX_LENGTH];
+} shim_persist_t;
+
+static shim_persist_t s_persist[SHIM_MAX_KEYS];
+static uint32_t s_persist_writes = 0;
+
+static shim_persist_t* shim_persist_find(uint32_t key, bool create)
+{
+  shim_persist_t *free_slot = NULL;
+
+  for (uint16_t i = 0; i < SHIM_MAX_KEYS; i++)
+  {
+    if (s_persist[i].used && s_persist[i].key == key)
+      return &s_persist[i];
+    if (!s_persist[i].used && free_slot == NULL)
+      free_slot = &s_persist[i];
+  }
+  if (!create || free_slot == NULL)
+    return NULL;
+  free_slot->used = true;
+  free_slot->key = key;
+  free_slot->size = 0;
+  return free_slot;
+}
+
+bool persist_exists(const uint32_t key)
+{
+  return shim_persist_find(key, false) != NULL;
+}
+
+int persist_get_size(const uint32_t key)
+{
+  shim_persist_t *entry = shim_persist_find(key, false);
+  return entry ? entry->size : E_DOES_NOT_EXIST;
+}
+
+int32_t persist_read_int(const uint32_t key)
+{
+  int32_t value = 0;
+  shim_persist_t *entry = shim_persist_find(key, false);
+  if (entry && entry->size == sizeof(value))
+    memcpy(&value, entry->data, sizeof(value));
+  return value;
+}
+
+status_t persist_write_int(const uint32_t key, const int32_t value)
+{
+  return persist_write_data(key, &value, sizeof(value)) == sizeof(value) ? S_SUCCESS : E_DOES_NOT_EXIST;
+}
+
+int persist_read_data(const uint32_t key, void *buffer, const size_t buffer_size)
+{
+  shim_persist_t *entry = shim_persist_find(key, false);
+  if (entry == NULL)
+    return E_DOES_NOT_EXIST;
+
+  size_t size = (entry->size < buffer_size) ? entry->size : buffer_size;
+  memcpy(buffer, entry->data, size);
+  return size;
+}
+
+int persist_write_data(const uint32_t key, const void *data, const size_t size)
+{
+  size_t stored = (size > PERSIST_DATA_MAX_LENGTH) ? PERSIST_DATA_MAX_LENGTH : size;
+  int old = persist_get_size(key);
+
+  if (shim_persist_used() - ((old > 0) ? old : 0) + stored > SHIM_PERSIST_SIZE)
+    return E_OUT_OF_STORAGE;
+
+  shim_persist_t *entry = shim_persist_find(key, true);
+  if (entry == NULL)
+  {
+    fprintf(stderr, "shim: out of persist keys\n");
+    abort();
+  }
+
+  entry->size = stored;
+  memcpy(entry->data, data, entry->size);
+  s_persist_writes++;
+  return entry->size;
+}
+
+status_t persist_delete(const uint32_t key)
+{
+  shim_persist_t *entry = shim_persist_find(key, false);
+  if (entry == NULL)
+    return E_DOES_NOT_EXIST;
+  entry->used = false;
+  return S_SUCCESS;
+}
+
+void shim_persist_clear(void)
+{
+  memset(s_persist, 0, sizeof(s_persist));
+  s_persist_writes = 0;
+}
+
+uint32_t shim_persist_writes(void)
+{
+  return s_persist_writes;
+}
+
+uint32_t shim_persist_used(void)
+{
+  uint32_t used = 0;
+
+  for (uint16_t i = 0; i < SHIM_MAX_KEYS; i++)
+  {
+    if (s_persist[i].used)
+      used += s_persist[i].size;
+  }
+  return used;
+}
+
+/******************************************************************************
+  Background worker
+******************************************************************************/
+static bool s_worker_running = false;
+static AppWorkerMessageHandler s_worker_handler = NULL;
+static ShimWorkerHook s_worker_init = NULL;
+static ShimWorkerHook s_worker_deinit = NULL;
+static ShimWorkerHook s_worker_launch_app = NULL;
+static uint32_t s_worker_app_launches = 0;
+
+void shim_worker_set(ShimWorkerHook init, ShimWorkerHook deinit, ShimWorkerHook launch_app)
+{
+  s_worker_init = init;
+  s_worker_deinit = deinit;
+  s_worker_launch_app = launch_app;
+  s_worker_app_launches = 0;
+}
+
+uint32_t shim_worker_app_launches(void)
+{
+  return s_worker_app_launches;
+}
+
+bool app_worker_is_running(void)
+{
+  return s_worker_running;
+}
+
+AppWorkerResult app_worker_launch(void)
+{
+  if (s_worker_running)
+    return APP_WORKER_RESULT_ALREADY_RUNNING;
+  s_worker_running = true;
+  if (s_worker_init)
+    s_worker_init();
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+AppWorkerResult app_worker_kill(void)
+{
+  if (!s_worker_running)
+    return APP_WORKER_RESULT_NOT_RUNNING;
+  s_worker_running = false;
+  if (s_worker_deinit)
+    s_worker_deinit();
+  return APP_WORKER_RESULT_SUCCESS;
+}
+
+bool app_worker_message_subscribe(AppWorkerMessageHandler handler)
+{
+  s_worker_handler = handler;
+  return true;
+}
+
+bool app_worker_message_unsubscribe(void)
+{
+  s_worker_handler = NULL;
+  return true;
+}
+
+// Only the worker subscribes, a message always goes from the app to it
+void app_worker_send_message(uint8_t type, AppWorkerMessage *data)
+{
+  if (s_worker_running && s_worker_handler)
+    s_worker_handler(type, data);
+}
+
+void worker_event_loop(void)
+{
+}
+
+void worker_launch_app(void)
+{
+  s_worker_app_launches++;
+  if (s_worker_launch_app)
+    s_worker_launch_app();
+}
+
+/******************************************************************************
+  Graphics
+******************************************************************************/
+struct GContext {
+  GColor fill;
+};
+
+struct GBitmap {
+  GRect bounds;
+};
+
+static struct GContext s_ctx;
+static struct GBitmap s_bitmap;
+
+#define SHIM_MAX_FILLS 1024
+static GRect s_fills[SHIM_MAX_FILLS];
+static uint32_t s_fill_count = 0;
+
+void graphics_context_set_fill_color(GContext *ctx, GColor color)
+{
+  ctx->fill = color;
+}
+
+void graphics_context_set_stroke_color(GContext *ctx, GColor color)
+{
+}
+
+void graphics_context_set_text_color(GContext *ctx, GColor color)
+{
+}
+
+void graphics_fill_rect(GContext *ctx, GRect rect, uint16_t corner_radius, GCornerMask corner_mask)
+{
+  if (s_fill_count < SHIM_MAX_FILLS)
+    s_fills[s_fill_count++] = rect;
+}
+
+void graphics_draw_rect(GContext *ctx, GRect rect)
+{
+}
+
+void graphics_draw_bitmap_in_rect(GContext *ctx, const GBitmap *bitmap, GRect rect)
+{
+}
+
+void graphics_draw_text(GContext *ctx, const char *text, GFont font, GRect box,
+                        GTextOverflowMode overflow_mode, GTextAlignment alignment, void *layout)
+{
+}
+
+uint32_t shim_fill_count(void)
+{
+  return s_fill_count;
+}
+
+GRect shim_fill_rect(uint32_t index)
+{
+  return (index < s_fill_count) ? s_fills[index] : GRect(0, 0, 0, 0);
+}
+
+void shim_fill_clear(void)
+{
+  s_fill_count = 0;
+}
+
+GBitmap* gbitmap_create_with_resource(uint32_t resource_id)
+{
+  return &s_bitmap;
+}
+
+GBitmap* gbitmap_create_as_sub_bitmap(const GBitmap *base_bitmap, GRect sub_rect)
+{
+  return &s_bitmap;
+}
+
+void gbitmap_destroy(GBitmap *bitmap)
+{
+}
+
+GFont fonts_get_system_font(const char *font_key)
+{
+  return NULL;
+}
+
+GFont fonts_load_custom_font(ResHandle handle)
+{
+  return NULL;
+}
+
+void fonts_unload_custom_font(GFont font)
+{
+}
+
+ResHandle resource_get_handle(uint32_t resource_id)
+{
+  return NULL;
+}
+
+// utils/bitmap-loader
+void bitmaps_init(void)
+{
+}
+
+GBitmap* bitmaps_get_bitmap(uint32_t res_id)
+{
+  return &s_bitmap;
+}
+
+GBitmap* bitmaps_get_bitmap_in_group(uint32_t res_id, uint8_t group)
+{
+  return &s_bitmap;
+}
+
+GBitmap* bitmaps_get_sub_bitmap(uint32_t res_id, GRect rect)
+{
+  return &s_bitmap;
+}
+
+void bitmaps_cleanup(void)
+{
+}
+
+/******************************************************************************
+  Layers
+******************************************************************************/
+struct Layer {
+  GRect           frame;
+  bool            hidden;
+  LayerUpdateProc update_proc;
+  uint32_t        dirty;
+  void           *data;
+};
+
+static void shim_layer_init(Layer *layer, GRect frame)
+{
+  memset(layer, 0, sizeof(*layer));
+  layer->frame = frame;
+}
+
+Layer* layer_create(GRect frame)
+{
+  return layer_create_with_data(frame, 0);
+}
+
+Layer* layer_create_with_data(GRect frame, size_t data_size)
+{
+  Layer *layer = malloc(sizeof(Layer));
+  shim_layer_init(layer, frame);
+  layer->data = data_size ? calloc(1, data_size) : NULL;
+  return layer;
+}
+
+void layer_destroy(Layer *layer)
+{
+  if (layer == NULL)
+    return;
+  free(layer->data);
+  free(layer);
+}
+
+void* layer_get_data(const Layer *layer)
+{
+  return layer->data;
+}
+
+void layer_set_update_proc(Layer *layer, LayerUpdateProc update_proc)
+{
+  layer->update_proc = update_proc;
+}
+
+void layer_mark_dirty(Layer *layer)
+{
+  layer->dirty++;
+}
+
+GRect layer_get_bounds(const Layer *layer)
+{
+  return GRect(0, 0, layer->frame.size.w, layer->frame.size.h);
+}
+
+GRect layer_get_frame(const Layer *layer)
+{
+  return layer->frame;
+}
+
+void layer_set_frame(Layer *layer, GRect frame)
+{
+  layer->frame = frame;
+}
+
+void layer_set_hidden(Layer *layer, bool hidden)
+{
+  layer->hidden = hidden;
+}
+
+void layer_add_child(Layer *parent, Layer *child)
+{
+}
+
+uint32_t shim_layer_dirty_count(const Layer *layer)
+{
+  return layer->dirty;
+}
+
+void shim_layer_draw(Layer *layer)
+{
+  if (layer->update_proc)
+    layer->update_proc(layer, &s_ctx);
+}
+
+struct TextLayer {
+  Layer       layer;
+  const char *text;
+};
+
+TextLayer* text_layer_create(GRect frame)
+{
+  TextLayer *text_layer = calloc(1, sizeof(TextLayer));
+  shim_layer_init(&text_layer->layer, frame);
+  text_layer->text = "";
+  return text_layer;
+}
+
+void text_layer_destroy(TextLayer *text_layer)
+{
+  free(text_layer);
+}
+
+Layer* text_layer_get_layer(TextLayer *text_layer)
+{
+  return &text_layer->layer;
+}
+
+void text_layer_set_text(TextLayer *text_layer, const char *text)
+{
+  text_layer->text = text ? text : "";
+  layer_mark_dirty(&text_layer->layer);
+}
+
+void text_layer_set_font(TextLayer *text_layer, GFont font)
+{
+}
+
+void text_layer_set_text_alignment(TextLayer *text_layer, GTextAlignment text_alignment)
+{
+}
+
+void text_layer_set_text_color(TextLayer *text_layer, GColor color)
+{
+}
+
+void text_layer_set_background_color(TextLayer *text_layer, GColor color)
+{
+}
+
+GSize text_layer_get_content_size(TextLayer *text_layer)
+{
+  return text_layer->layer.frame.size;
+}
+
+void text_layer_set_size(TextLayer *text_layer, const GSize max_size)
+{
+  text_layer->layer.frame.size = max_size;
+}
+
+const char* shim_text_layer_text(const TextLayer *text_layer)
+{
+  return text_layer->text;
+}
+
+struct ScrollLayer {
+  Layer layer;
+};
+
+ScrollLayer* scroll_layer_create(GRect frame)
+{
+  ScrollLayer *scroll_layer = calloc(1, sizeof(ScrollLayer));
+  shim_layer_init(&scroll_layer->layer, frame);
+  return scroll_layer;
+}
+
+void scroll_layer_destroy(ScrollLayer *scroll_layer)
+{
+  free(scroll_layer);
+}
+
+Layer* scroll_layer_get_layer(const ScrollLayer *scroll_layer)
+{
+  return (Layer*)&scroll_layer->layer;
+}
+
+void scroll_layer_add_child(ScrollLayer *scroll_layer, Layer *child)
+{
+}
+
+void scroll_layer_set_content_size(ScrollLayer *scroll_layer, GSize size)
+{
+}
+
+struct StatusBarLayer {
+  Layer layer;
+};
+
+StatusBarLayer* status_bar_layer_create(void)
+{
+  StatusBarLayer *status_bar_layer = calloc(1, sizeof(StatusBarLayer));
+  shim_layer_init(&status_bar_layer->layer, GRect(0, 0, 144, 16));
+  return status_bar_layer;
+}
+
+void status_bar_layer_destroy(StatusBarLayer *status_bar_layer)
+{
+  free(status_bar_layer);
+}
+
+Layer* status_bar_layer_get_layer(StatusBarLayer *status_bar_layer)
+{
+  return &status_bar_layer->layer;
+}
+
+void status_bar_layer_set_colors(StatusBarLayer *status_bar_layer, GColor background, GColor foreground)
+{
+}
+
+void status_bar_layer_set_separator_mode(StatusBarLayer *status_bar_layer, StatusBarLayerSeparatorMode mode)
+{
+}
+
+// utils/scroll-text-layer
+struct ScrollTextLayer {
+  ScrollLayer *scroll_layer;
+  TextLayer   *text_layer;
+};
+
+ScrollTextLayer* scroll_text_layer_create(GRect rect)
+{
+  ScrollTextLayer *layer = calloc(1, sizeof(ScrollTextLayer));
+  layer->scroll_layer = scroll_layer_create(rect);
+  layer->text_layer = text_layer_create(rect);
+  return layer;
+}
+
+void scroll_text_layer_destroy(ScrollTextLayer* layer)
+{
+  if (layer == NULL)
+    return;
+  scroll_layer_destroy(layer->scroll_layer);
+  text_layer_destroy(layer->text_layer);
+  free(layer);
+}
+
+TextLayer* scroll_text_layer_get_text_layer(ScrollTextLayer* layer)
+{
+  return layer->text_layer;
+}
+
+ScrollLayer* scroll_text_layer_get_scroll_layer(ScrollTextLayer* layer)
+{
+  return layer->scroll_layer;
+}
+
+void scroll_text_layer_add_to_window(ScrollTextLayer* layer, Window* window)
+{
+}
+
+void scroll_text_layer_set_text(ScrollTextLayer* layer, char* text)
+{
+  text_layer_set_text(layer->text_layer, text);
+}
+
+void scroll_text_layer_set_font(ScrollTextLayer* layer, GFont font)
+{
+}
+
+/******************************************************************************
+  Windows and the window stack
+******************************************************************************/
+struct ActionBarLayer {
+  Layer               layer;
+  ClickConfigProvider click_config_provider;
+  Window             *window;
+};
+
+struct MenuLayer {
+  Layer               layer;
+  MenuLayerCallbacks  callbacks;
+  void               *context;
+  MenuIndex           selected;
+};
+
+struct Window {
+  Layer               root;
+  WindowHandlers      handlers;
+  ClickConfigProvider click_config_provider;
+  ActionBarLayer     *action_bar;
+  MenuLayer          *menu;
+};
+
+#define SHIM_MAX_WINDOWS 8
+static Window *s_stack[SHIM_MAX_WINDOWS];
+static uint8_t s_stack_count = 0;
+
+Window* window_create(void)
+{
+  Window *window = calloc(1, sizeof(Window));
+  shim_layer_init(&window->root, GRect(0, 0, 144, 168));
+  return window;
+}
+
+void window_destroy(Window *window)
+{
+  free(window);
+}
+
+void window_set_window_handlers(Window *window, WindowHandlers handlers)
+{
+  window->handlers = handlers;
+}
+
+Layer* window_get_root_layer(const Window *window)
+{
+  return (Layer*)&window->root;
+}
+
+void window_set_background_color(Window *window, GColor background_color)
+{
+}
+
+void window_set_click_config_provider(Window *window, ClickConfigProvider click_config_provider)
+{
+  window->click_config_provider = click_config_provider;
+}
+
+Window* shim_top_window(void)
+{
+  return s_stack_count ? s_stack[s_stack_count - 1] : NULL;
+}
+
+void window_stack_push(Window *window, bool animated)
+{
+  Window *previous = shim_top_window();
+
+  if (s_stack_count >= SHIM_MAX_WINDOWS)
+  {
+    fprintf(stderr, "shim: window stack full\n");
+    abort();
+  }
+  if (previous && previous->handlers.disappear)
+    previous->handlers.disappear(previous);
+
+  s_stack[s_stack_count++] = window;
+  if (window->handlers.load)
+    window->handlers.load(window);
+  if (window->handlers.appear)
+    window->handlers.appear(window);
+}
+
+Window* window_stack_pop(bool animated)
+{
+  Window *window = shim_top_window();
+  Window *top;
+
+  if (window == NULL)
+    return NULL;
+
+  if (window->handlers.disappear)
+    window->handlers.disappear(window);
+  s_stack_count--;
+  if (window->handlers.unload)
+    window->handlers.unload(window);
+
+  top = shim_top_window();
+  if (top && top->handlers.appear)
+    top->handlers.appear(top);
+  return window;
+}
+
+/******************************************************************************
+  Clicks
+
+  The click config provider of the top window is run on every button press
+  to collect what is subscribed, then the press is handed to the handlers.
+******************************************************************************/
+typedef struct {
+  ClickHandler  single;
+  uint16_t      repeat_ms;
+  ClickHandler  multi;
+  uint8_t       multi_min;
+  uint8_t       multi_max;
+  ClickHandler  long_down;
+  ClickHandler  long_up;
+  ClickHandler  raw_down;
+  ClickHandler  raw_up;
+  void         *raw_context;
+} shim_click_config_t;
+
+typedef struct {
+  uint8_t clicks;
+  bool    repeating;
+} shim_recognizer_t;
+
+static shim_click_config_t s_click[NUM_BUTTONS];
+
+void window_single_click_subscribe(ButtonId button_id, ClickHandler handler)
+{
+  s_click[button_id].single = handler;
+}
+
+void window_single_repeating_click_subscribe(ButtonId button_id, uint16_t repeat_interval_ms, ClickHandler handler)
+{
+  s_click[button_id].single = handler;
+  s_click[button_id].repeat_ms = repeat_interval_ms;
+}
+
+void window_multi_click_subscribe(ButtonId button_id, uint8_t min_clicks, uint8_t max_clicks, uint16_t timeout,
+                                  bool last_click_only, ClickHandler handler)
+{
+  s_click[button_id].multi = handler;
+  s_click[button_id].multi_min = min_clicks;
+  s_click[button_id].multi_max = max_clicks;
+}
+
+void window_long_click_subscribe(ButtonId button_id, uint16_t delay_ms, ClickHandler down_handler, ClickHandler up_handler)
+{
+  s_click[button_id].long_down = down_handler;
+  s_click[button_id].long_up = up_handler;
+}
+
+void window_raw_click_subscribe(ButtonId button_id, ClickHandler down_handler, ClickHandler up_handler, void *context)
+{
+  s_click[button_id].raw_down = down_handler;
+  s_click[button_id].raw_up = up_handler;
+  s_click[button_id].raw_context = context;
+}
+
+uint8_t click_number_of_clicks_counted(ClickRecognizerRef recognizer)
+{
+  return ((shim_recognizer_t*)recognizer)->clicks;
+}
+
+bool click_recognizer_is_repeating(ClickRecognizerRef recognizer)
+{
+  return ((shim_recognizer_t*)recognizer)->repeating;
+}
+
+static void shim_menu_click(Window *window, ButtonId button, bool long_click);
+
+// Scrolling is not simulated, only back pops the window
+void scroll_layer_set_click_config_onto_window(ScrollLayer *scroll_layer, Window *window)
+{
+}
+
+// Collects the subscriptions of the top window, false if a menu takes the clicks
+static bool shim_click_config(Window *window)
+{
+  memset(s_click, 0, sizeof(s_click));
+  if (window->action_bar && window->action_bar->click_config_provider)
+    window->action_bar->click_config_provider(window);
+  else if (window->click_config_provider)
+    window->click_config_provider(window);
+  else if (window->menu)
+    return false;
+  return true;
+}
+
+void shim_click(ButtonId button, uint8_t clicks)
+{
+  Window *window = shim_top_window();
+  shim_recognizer_t recognizer = { .clicks = clicks, .repeating = false };
+
+  if (window == NULL)
+    return;
+
+  if (!shim_click_config(window))
+  {
+    for (uint8_t i = 0; i < clicks; i++)
+      shim_menu_click(window, button, false);
+    return;
+  }
+
+  shim_click_config_t *config = &s_click[button];
+  if (config->multi && clicks >= config->multi_min && clicks <= config->multi_max)
+  {
+    config->multi(&recognizer, window);
+  }
+  else if (config->single)
+  {
+    for (uint8_t i = 1; i <= clicks; i++)
+    {
+      recognizer.clicks = i;
+      if (config->raw_down)
+        config->raw_down(&recognizer, config->raw_context);
+      config->single(&recognizer, window);
+      if (config->raw_up)
+        config->raw_up(&recognizer, config->raw_context);
+    }
+  }
+  else if (button == BUTTON_ID_BACK)
+  {
+    window_stack_pop(true);
+  }
+}
+
+// Press and hold: a repeating click fires after every repeat interval, the
+// app timers run in between, a long click fires once
+void shim_hold(ButtonId button, uint8_t repeats)
+{
+  Window *window = shim_top_window();
+  shim_recognizer_t recognizer = { .clicks = 1, .repeating = true };
+
+  if (window == NULL)
+    return;
+
+  if (!shim_click_config(window))
+  {
+    shim_menu_click(window, button, true);
+    return;
+  }
+
+  shim_click_config_t config = s_click[button];
+  if (config.raw_down)
+    config.raw_down(&recognizer, config.raw_context);
+
+  if (config.long_down)
+  {
+    config.long_down(&recognizer, window);
+    if (config.long_up)
+      config.long_up(&recognizer, window);
+  }
+  else if (config.single && config.repeat_ms)
+  {
+    for (uint8_t i = 0; i < repeats; i++)
+    {
+      shim_run_for(config.repeat_ms);
+      config.single(&recognizer, window);
+    }
+  }
+
+  if (config.raw_up)
+    config.raw_up(&recognizer, config.raw_context);
+}
+
+/******************************************************************************
+  Action bar
+******************************************************************************/
+ActionBarLayer* action_bar_layer_create(void)
+{
+  ActionBarLayer *action_bar = calloc(1, sizeof(ActionBarLayer));
+  shim_layer_init(&action_bar->layer, GRect(144 - ACTION_BAR_WIDTH, 0, ACTION_BAR_WIDTH, 168));
+  return action_bar;
+}
+
+void action_bar_layer_destroy(ActionBarLayer *action_bar)
+{
+  if (action_bar && action_bar->window)
+    action_bar->window->action_bar = NULL;
+  free(action_bar);
+}
+
+void action_bar_layer_add_to_window(ActionBarLayer *action_bar, Window *window)
+{
+  action_bar->window = window;
+  window->action_bar = action_bar;
+}
+
+void action_bar_layer_remove_from_window(ActionBarLayer *action_bar)
+{
+  if (action_bar->window)
+    action_bar->window->action_bar = NULL;
+  action_bar->window = NULL;
+}
+
+void action_bar_layer_set_click_config_provider(ActionBarLayer *action_bar, ClickConfigProvider click_config_provider)
+{
+  action_bar->click_config_provider = click_config_provider;
+}
+
+void action_bar_layer_set_icon(ActionBarLayer *action_bar, ButtonId button_id, const GBitmap *icon)
+{
+}
+
+void action_bar_layer_clear_icon(ActionBarLayer *action_bar, ButtonId button_id)
+{
+}
+
+void action_bar_layer_set_background_color(ActionBarLayer *action_bar, GColor background_color)
+{
+}
+
+/******************************************************************************
+  Menus
+******************************************************************************/
+static const char *s_cell_title = NULL;
+static const char *s_cell_subtitle = NULL;
+
+MenuLayer* menu_layer_create(GRect frame)
+{
+  MenuLayer *menu_layer = calloc(1, sizeof(MenuLayer));
+  shim_layer_init(&menu_layer->layer, frame);
+  return menu_layer;
+}
+
+void menu_layer_destroy(MenuLayer *menu_layer)
+{
+  for (uint8_t i = 0; i < s_stack_count; i++)
+  {
+    if (s_stack[i]->menu == menu_layer)
+      s_stack[i]->menu = NULL;
+  }
+  free(menu_layer);
+}
+
+Layer* menu_layer_get_layer(const MenuLayer *menu_layer)
+{
+  return (Layer*)&menu_layer->layer;
+}
+
+void menu_layer_set_callbacks(MenuLayer *menu_layer, void *callback_context, MenuLayerCallbacks callbacks)
+{
+  menu_layer->callbacks = callbacks;
+  menu_layer->context = callback_context;
+}
+
+void menu_layer_set_click_config_onto_window(MenuLayer *menu_layer, Window *window)
+{
+  window->menu = menu_layer;
+}
+
+void menu_layer_set_highlight_colors(MenuLayer *menu_layer, GColor background, GColor foreground)
+{
+}
+
+void menu_layer_set_selected_index(MenuLayer *menu_layer, MenuIndex index, MenuRowAlign scroll_align, bool animated)
+{
+  menu_layer->selected = index;
+}
+
+void menu_layer_reload_data(MenuLayer *menu_layer)
+{
+  layer_mark_dirty(&menu_layer->layer);
+}
+
+void menu_cell_basic_draw(GContext *ctx, const Layer *cell_layer, const char *title, const char *subtitle, GBitmap *icon)
+{
+  s_cell_title = title;
+  s_cell_subtitle = subtitle;
+}
+
+void menu_cell_title_draw(GContext *ctx, const Layer *cell_layer, const char *title)
+{
+  s_cell_title = title;
+  s_cell_subtitle = NULL;
+}
+
+void menu_cell_basic_header_draw(GContext *ctx, const Layer *cell_layer, const char *title)
+{
+}
+
+MenuLayer* shim_top_menu(void)
+{
+  Window *window = shim_top_window();
+  return window ? window->menu : NULL;
+}
+
+uint16_t shim_menu_num_rows(MenuLayer *menu_layer, uint16_t section)
+{
+  return menu_layer->callbacks.get_num_rows(menu_layer, section, menu_layer->context);
+}
+
+static void shim_menu_move(MenuLayer *menu_layer, MenuIndex index)
+{
+  MenuIndex old_index = menu_layer->selected;
+
+  if (old_index.section != index.section || old_index.row != index.row)
+  {
+    menu_layer->selected = index;
+    if (menu_layer->callbacks.selection_changed)
+      menu_layer->callbacks.selection_changed(menu_layer, index, old_index, menu_layer->context);
+  }
+}
+
+void shim_menu_select(MenuLayer *menu_layer, uint16_t section, uint16_t row, bool long_click)
+{
+  MenuIndex index = { .section = section, .row = row };
+
+  shim_menu_move(menu_layer, index);
+  if (long_click && menu_layer->callbacks.select_long_click)
+    menu_layer->callbacks.select_long_click(menu_layer, &index, menu_layer->context);
+  else if (!long_click && menu_layer->callbacks.select_click)
+    menu_layer->callbacks.select_click(menu_layer, &index, menu_layer->context);
+}
+
+void shim_menu_draw_row(MenuLayer *menu_layer, uint16_t section, uint16_t row)
+{
+  MenuIndex index = { .section = section, .row = row };
+
+  s_cell_title = NULL;
+  s_cell_subtitle = NULL;
+  menu_layer->callbacks.draw_row(&s_ctx, &menu_layer->layer, &index, menu_layer->context);
+}
+
+const char* shim_cell_title(void)
+{
+  return s_cell_title ? s_cell_title : "";
+}
+
+const char* shim_cell_subtitle(void)
+{
+  return s_cell_subtitle ? s_cell_subtitle : "";
+}
+
+// Up and down move the selection, select clicks the selected row, back pops
+static void shim_menu_click(Window *window, ButtonId button, bool long_click)
+{
+  MenuLayer *menu_layer = window->menu;
+  MenuIndex index = menu_layer->selected;
+
+  switch (button)
+  {
+    case BUTTON_ID_UP:
+      if (index.row > 0)
+        index.row--;
+      else if (index.section > 0)
+      {
+        index.section--;
+        index.row = shim_menu_num_rows(menu_layer, index.section) - 1;
+      }
+      shim_menu_move(menu_layer, index);
+      break;
+    case BUTTON_ID_DOWN:
+      if (index.row + 1 < shim_menu_num_rows(menu_layer, index.section))
+        index.row++;
+      else if (menu_layer->callbacks.get_num_sections &&
+               index.section + 1 < menu_layer->callbacks.get_num_sections(menu_layer, menu_layer->context))
+      {
+        index.section++;
+        index.row = 0;
+      }
+      shim_menu_move(menu_layer, index);
+      break;
+    case BUTTON_ID_SELECT:
+      shim_menu_select(menu_layer, index.section, index.row, long_click);
+      break;
+    case BUTTON_ID_BACK:
+      window_stack_pop(true);
+      break;
+    default:
+      break;
+  }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+// Test side of the host shim: drive the virtual clock, press buttons and
+// look at what the app did.
+
+#include "pebble.h"
+
+// Virtual clock, ms since the epoch. It only moves when a test moves it.
+uint64_t shim_now_ms(void);
+void shim_set_now_ms(uint64_t now_ms);
+
+// Run the app timers and tick handlers due until the clock reaches until_ms.
+// Each app timer callback runs late by a random 0 to max_late_ms.
+void shim_run_until(uint64_t until_ms);
+void shim_run_for(uint32_t ms);
+void shim_set_jitter(uint32_t max_late_ms, unsigned int seed);
+uint32_t shim_wakeups(void);            // app timer callbacks run so far
+uint8_t shim_timers_pending(void);
+
+// Vibes, every call in order
+#define SHIM_VIBE_MAX_SEGMENTS 16
+
+typedef enum {
+  SHIM_VIBE_SHORT,
+  SHIM_VIBE_LONG,
+  SHIM_VIBE_DOUBLE,
+  SHIM_VIBE_PATTERN,
+  SHIM_VIBE_CANCEL,
+} ShimVibeKind;
+
+typedef struct {
+  uint64_t      at_ms;
+  ShimVibeKind  kind;
+  uint32_t      num_segments;
+  uint32_t      durations[SHIM_VIBE_MAX_SEGMENTS];
+} ShimVibe;
+
+uint32_t shim_vibes_count(void);
+const ShimVibe* shim_vibe(uint32_t index);
+void shim_vibes_clear(void);
+
+// Storage, a write that would take more than SHIM_PERSIST_SIZE bytes in
+// all fails as on the watch
+#define SHIM_PERSIST_SIZE 4096
+void shim_persist_clear(void);
+uint32_t shim_persist_writes(void);
+uint32_t shim_persist_used(void);
+
+// Windows and buttons, acting on the window on top of the stack
+Window* shim_top_window(void);
+void shim_click(ButtonId button, uint8_t clicks);
+void shim_hold(ButtonId button, uint8_t repeats);
+
+// Menus, the menu set up on the window on top of the stack
+MenuLayer* shim_top_menu(void);
+uint16_t shim_menu_num_rows(MenuLayer *menu_layer, uint16_t section);
+void shim_menu_select(MenuLayer *menu_layer, uint16_t section, uint16_t row, bool long_click);
+
+// Draws a row, the title and subtitle it drew are kept
+void shim_menu_draw_row(MenuLayer *menu_layer, uint16_t section, uint16_t row);
+const char* shim_cell_title(void);
+const char* shim_cell_subtitle(void);
+
+// Layers
+const char* shim_text_layer_text(const TextLayer *text_layer);
+uint32_t shim_layer_dirty_count(const Layer *layer);
+void shim_layer_draw(Layer *layer);
+
+// Filled rectangles in the order drawn since the last clear
+uint32_t shim_fill_count(void);
+GRect shim_fill_rect(uint32_t index);
+void shim_fill_clear(void);
+
+// Logging, the last line formatted through app_log. A handler set is given
+// every line.
+typedef void (*ShimLogHandler)(const char *line);
+
+const char* shim_last_log(void);
+uint32_t shim_log_count(void);
+void shim_set_log_handler(ShimLogHandler handler);
+
+// Background worker, run in the same program as the app. init and deinit
+// are run when the app launches and kills the worker, launch_app when the
+// worker launches the app. The worker shares the tick service with the app,
+// which does not use it.
+typedef void (*ShimWorkerHook)(void);
+
+void shim_worker_set(ShimWorkerHook init, ShimWorkerHook deinit, ShimWorkerHook launch_app);
+uint32_t shim_worker_app_launches(void);
@@ -0,0 +1,4 @@
+#pragma once
+
+// The worker API is the part of the app API the shim already covers
+#include "pebble.h"
@@ -0,0 +1,34 @@
+#pragma once
+
+// Checks for the host tests: a failed check is reported and counted, the
+// test goes on and exits non-zero at the end.
+
+#include <stdio.h>
+
+static int s_test_failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      s_test_failures++; \
+    } \
+  } while (0)
+
+#define CHECK_EQ(actual, expected) do { \
+    long long a_ = (long long)(actual), e_ = (long long)(expected); \
+    if (a_ != e_) { \
+      fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+      s_test_failures++; \
+    } \
+  } while (0)
+
+#define CHECK_STR(actual, expected) do { \
+    const char *a_ = (actual), *e_ = (expected); \
+    if (strcmp(a_, e_) != 0) { \
+      fprintf(stderr, "%s:%d: %s is \"%s\", expected \"%s\"\n", __FILE__, __LINE__, #actual, a_, e_); \
+      s_test_failures++; \
+    } \
+  } while (0)
+
+#define TEST_RESULT(name) \
+  (fprintf(stderr, "%s: %s\n", (name), s_test_failures ? "FAILED" : "ok"), s_test_failures ? 1 : 0)
@@ -0,0 +1,108 @@
+// The vibes of a full heat, a program of a pre race, a race and an after
+// race phase, pulse by pulse: the intervals, the alert points, the EOR
+// warning and the end vibes, coincident alerts given once and an alert
+// falling on a playing end vibe dropped.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "settings/settings.h"
+#include "raceTimer/raceTimer.h"
+
+typedef struct {
+  uint32_t      at_ms;          // since the heat was started
+  uint32_t      num_segments;
+  uint32_t      durations[5];
+} Pulse;
+
+#define SHORT   1, { 150 }
+#define DOUBLE  3, { 600, 200, 600 }
+#define TRIPLE  5, { 600, 200, 600, 200, 600 }
+
+static const Pulse EXPECTED[] = {
+  {   5000, SHORT },            // pre race interval, 5 s left
+  {  10000, DOUBLE },           // pre race end, the alert 59 s before the race end is dropped
+  {  25000, SHORT },            // alert, 45 s left
+  {  30000, SHORT },            // interval, 40 s left
+  {  50000, SHORT },            // interval and alert, 20 s left
+  {  67000, SHORT },            // warning, 3 s left
+  {  68000, SHORT },
+  {  69000, SHORT },
+  {  70000, TRIPLE },           // race end
+  { 100000, SHORT },            // after race interval
+  { 130000, SHORT },
+};
+
+// The profile as an older version of the app left it, active and alone
+static void store_profile(void)
+{
+  settings_packed_t packed = {
+    .program = {
+      .num_phases = 3,
+      .phases = {
+        { .type = SETTINGS_PHASE_PRE_RACE, .end_vibe = TIMER_VIBE_DOUBLE,
+          .resolution = TIMER_RES_SECOND, .duration = 10, .interval = 5 },
+        { .type = SETTINGS_PHASE_RACE, .end_vibe = TIMER_VIBE_TRIPLE,
+          .resolution = TIMER_RES_SECOND, .duration = 60, .interval = 20,
+          .warning = 3, .alerts = { 59, 45, 20 } },
+        { .type = SETTINGS_PHASE_AFTER_RACE, .end_vibe = TIMER_VIBE_NONE,
+          .resolution = TIMER_RES_SECOND, .interval = 30 },
+      },
+    },
+  };
+  persist_write_int(SETTINGS_VERSION_KEY, SETTINGS_VERSION_CURRENT);
+  persist_write_int(SETTINGS_ACTIVE_KEY, 0);
+  persist_write_data(SETTINGS_PROFILE_KEY, &packed, sizeof(packed));
+}
+
+int main(void)
+{
+  store_profile();
+  settings_init();
+  racetimer_init();
+
+  uint64_t start_ms = shim_now_ms();
+  shim_vibes_clear();
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(140 * 1000);
+
+  // nothing is cancelled, no pattern overlaps the one before
+  CHECK_EQ(shim_vibes_count(), ARRAY_LENGTH(EXPECTED));
+  for (uint32_t i = 0; i < shim_vibes_count() && i < ARRAY_LENGTH(EXPECTED); i++)
+  {
+    const ShimVibe *vibe = shim_vibe(i);
+    const Pulse *pulse = &EXPECTED[i];
+
+    CHECK_EQ(vibe->kind, SHIM_VIBE_PATTERN);
+    CHECK_EQ(vibe->at_ms - start_ms, pulse->at_ms);
+    CHECK_EQ(vibe->num_segments, pulse->num_segments);
+    for (uint32_t s = 0; s < pulse->num_segments && s < vibe->num_segments; s++)
+      CHECK_EQ(vibe->durations[s], pulse->durations[s]);
+  }
+
+  // late wakeups delay a pulse by their own lateness, the phases after a
+  // late expiry are not moved. The start waits for the queue run, a pulse
+  // for its wakeup, each late by up to the jitter.
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  shim_set_jitter(80, 1);
+  start_ms = shim_now_ms();
+  shim_vibes_clear();
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(140 * 1000);
+
+  CHECK_EQ(shim_vibes_count(), ARRAY_LENGTH(EXPECTED));
+  for (uint32_t i = 0; i < shim_vibes_count() && i < ARRAY_LENGTH(EXPECTED); i++)
+  {
+    const ShimVibe *vibe = shim_vibe(i);
+    uint64_t at_ms = vibe->at_ms - start_ms;
+
+    CHECK_EQ(vibe->num_segments, EXPECTED[i].num_segments);
+    CHECK(at_ms >= EXPECTED[i].at_ms && at_ms <= EXPECTED[i].at_ms + 2 * 80);
+  }
+  shim_set_jitter(0, 0);
+
+  window_stack_pop(false);
+  racetimer_deinit();
+  settings_deinit();
+  return TEST_RESULT("test_haptic");
+}
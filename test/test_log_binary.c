@@ -0,0 +1,99 @@
+// Binary log: the records are formatted at the flush the way app_log would
+// have formatted them when logged, strings included.
+
+#include "pebble_shim.h"
+#include "test.h"
+
+#define LOG_BINARY_SIZE 4
+#include "log.c"
+
+#define BLOG(nargs, ...) log_binary(APP_LOG_LEVEL_DEBUG, __FILE__, __LINE__, nargs, __VA_ARGS__)
+
+static char s_lines[LOG_BINARY_SIZE + 1][LOG_LINE_SIZE];
+static uint8_t s_count;
+
+static void collect(const char *line)
+{
+  if (s_count < ARRAY_LENGTH(s_lines))
+    snprintf(s_lines[s_count++], LOG_LINE_SIZE, "%s", line);
+}
+
+static void flush(void)
+{
+  s_count = 0;
+  shim_set_log_handler(collect);
+  log_flush();
+  shim_set_log_handler(NULL);
+}
+
+// A string is shown as it was when logged, not as it is at the flush
+static void test_strings(void)
+{
+  char name[16] = "Profile 1";
+
+  BLOG(2, "%s active %d", name, 3);
+  strcpy(name, "changed");
+  BLOG(3, "[%-8s][%3s]%s", name, "ab", "");
+  flush();
+
+  CHECK_EQ(s_count, 2);
+  CHECK_STR(s_lines[0], "Profile 1 active 3");
+  CHECK_STR(s_lines[1], "[changed ][ ab]");
+}
+
+// The strings of a record share LOG_STR_SIZE bytes, the last ones are cut
+static void test_long_strings(void)
+{
+  BLOG(3, "%s|%s|%s", "0123456789abcdef", "0123456789", "xyz");
+  flush();
+
+  CHECK_EQ(s_count, 1);
+  CHECK_STR(s_lines[0], "0123456789abcdef|012345|");
+}
+
+// Every supported conversion against snprintf, with %% and 4 arguments
+static void test_conversions(void)
+{
+  char expected[LOG_LINE_SIZE];
+  int value = -42;
+  unsigned long big = 4000000000UL;
+  void *ptr = &value;
+
+  BLOG(4, "%d%% %u %5x %c", value, 42u, 0xbeefu, 'k');
+  BLOG(4, "%lu %ld %p %02d", big, -7L, ptr, 5);
+  BLOG(2, "%s=%ld", "big", (long)big);
+  flush();
+
+  CHECK_EQ(s_count, 3);
+  snprintf(expected, sizeof(expected), "%d%% %u %5x %c", value, 42u, 0xbeefu, 'k');
+  CHECK_STR(s_lines[0], expected);
+  snprintf(expected, sizeof(expected), "%lu %ld %p %02d", big, -7L, ptr, 5);
+  CHECK_STR(s_lines[1], expected);
+  snprintf(expected, sizeof(expected), "%s=%ld", "big", (long)big);
+  CHECK_STR(s_lines[2], expected);
+}
+
+// The oldest records are overwritten and counted
+static void test_dropped(void)
+{
+  for (int i = 0; i < LOG_BINARY_SIZE + 2; i++)
+    BLOG(1, "record %d", i);
+  flush();
+
+  CHECK_EQ(s_count, LOG_BINARY_SIZE + 1);
+  CHECK_STR(s_lines[0], "log: 2 records dropped");
+  CHECK_STR(s_lines[1], "record 2");
+  CHECK_STR(s_lines[LOG_BINARY_SIZE], "record 5");
+
+  flush();
+  CHECK_EQ(s_count, 0);
+}
+
+int main(void)
+{
+  test_strings();
+  test_long_strings();
+  test_conversions();
+  test_dropped();
+  return TEST_RESULT("test_log_binary");
+}
@@ -0,0 +1,180 @@
+// Profile list: a long select only asks to delete a profile, a select on it
+// deletes it, the active profile is named in the name editor, and profiles
+// are added while the storage has room for them.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "settings/settings.h"
+
+static MenuLayer* open_profiles(void)
+{
+  settings_push_window(NULL);
+  shim_menu_select(shim_top_menu(), 0, 0, false);
+  return shim_top_menu();
+}
+
+static void close_all(void)
+{
+  while (shim_top_window())
+    window_stack_pop(false);
+}
+
+static const char* subtitle(MenuLayer *menu, uint16_t row)
+{
+  shim_menu_draw_row(menu, 0, row);
+  return shim_cell_subtitle();
+}
+
+static void test_delete(void)
+{
+  MenuLayer *menu = open_profiles();
+  uint8_t count = settings_get_num_of_profiles();
+
+  // asked, then kept when another row is selected
+  shim_menu_select(menu, 0, 2, true);
+  CHECK_EQ(settings_get_num_of_profiles(), count);
+  CHECK_STR(subtitle(menu, 2), "Select to delete");
+  shim_menu_select(menu, 0, 3, false);
+  CHECK_EQ(settings_get_num_of_profiles(), count);
+  CHECK_EQ(settings_get_active_profile(), 3);
+  close_all();
+
+  // asked, then kept when the selection moves
+  menu = open_profiles();
+  shim_menu_select(menu, 0, 2, true);
+  shim_click(BUTTON_ID_DOWN, 1);
+  CHECK_STR(subtitle(menu, 2), "");
+  shim_menu_select(menu, 0, 2, true);
+  shim_menu_select(menu, 0, 2, false);
+  CHECK_EQ(settings_get_num_of_profiles(), count - 1);
+  CHECK_EQ(settings_get_active_profile(), 2);
+  close_all();
+
+  // the last profile is not offered for deletion
+  menu = open_profiles();
+  while (settings_get_num_of_profiles() > 1)
+  {
+    shim_menu_select(menu, 0, 0, true);
+    shim_menu_select(menu, 0, 0, false);
+  }
+  shim_menu_select(menu, 0, 0, true);
+  CHECK_STR(subtitle(menu, 0), "Active");
+  close_all();
+}
+
+static void test_name(void)
+{
+  char name[SETTINGS_NAME_LEN];
+  MenuLayer *menu = open_profiles();
+
+  shim_menu_select(menu, 0, settings_get_active_profile(), false);
+  CHECK(shim_top_menu() == NULL);
+  shim_click(BUTTON_ID_UP, 1);          // A
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_UP, 2);          // B
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_DOWN, 1);        // -, down from a space
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_UP, 28);         // 1
+  shim_click(BUTTON_ID_BACK, 1);
+  CHECK(shim_top_menu() == menu);
+
+  settings_get_profile_name(settings_get_active_profile(), name, sizeof(name));
+  CHECK_STR(name, "AB-1");
+  CHECK_STR(settings()->name, "AB-1");
+  close_all();
+
+  // stored with the profile when the settings are closed, a classic profile
+  // without phases
+  settings_packed_t packed;
+  CHECK_EQ(persist_read_data(SETTINGS_PROFILE_KEY + settings_get_active_profile_id(), &packed, sizeof(packed)),
+           SETTINGS_PACKED_SIZE(0));
+  CHECK_STR(packed.name, "AB-1");
+
+  // all spaces give the default name back
+  menu = open_profiles();
+  shim_menu_select(menu, 0, settings_get_active_profile(), false);
+  shim_click(BUTTON_ID_DOWN, 1);        // A to the space
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_DOWN, 2);        // B to the space
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_UP, 1);          // - to the space
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_click(BUTTON_ID_DOWN, 28);       // 1 to the space
+  shim_click(BUTTON_ID_BACK, 1);
+  settings_get_profile_name(settings_get_active_profile(), name, sizeof(name));
+  CHECK_STR(name, "Profile 1");
+  close_all();
+}
+
+// Bytes the profiles and their index take in the persistent storage
+static int store_used(void)
+{
+  int used = persist_get_size(SETTINGS_INDEX_KEY);
+
+  for (uint8_t id = 0; id < SETTINGS_MAX_PROFILES; id++)
+  {
+    if (persist_exists(SETTINGS_PROFILE_KEY + id))
+      used += persist_get_size(SETTINGS_PROFILE_KEY + id);
+  }
+  return used;
+}
+
+static void add_until_refused(MenuLayer *menu)
+{
+  uint8_t count;
+
+  do {
+    count = settings_get_num_of_profiles();
+    shim_menu_select(menu, 0, count, false);
+  } while (settings_get_num_of_profiles() > count);
+}
+
+// New profiles are copies of the active one, they are added while the
+// storage has room. Classic profiles take all the ids, programs of eight
+// phases fill the storage first and the new profile row says so.
+static void test_full(void)
+{
+  MenuLayer *menu = open_profiles();
+
+  add_until_refused(menu);
+  CHECK_EQ(settings_get_num_of_profiles(), SETTINGS_MAX_PROFILES);
+  CHECK(store_used() <= SETTINGS_STORE_SIZE);
+  while (settings_get_num_of_profiles() > 1)
+  {
+    shim_menu_select(menu, 0, 0, true);
+    shim_menu_select(menu, 0, 0, false);
+  }
+  close_all();
+
+  while (settings_add_phase())
+    ;
+  CHECK_EQ(settings_program()->num_phases, SETTINGS_MAX_PHASES);
+  menu = open_profiles();
+  add_until_refused(menu);
+  uint8_t count = settings_get_num_of_profiles();
+  CHECK(count < SETTINGS_MAX_PROFILES);
+  CHECK(store_used() <= SETTINGS_STORE_SIZE);
+  CHECK(store_used() + SETTINGS_PACKED_SIZE(SETTINGS_MAX_PHASES) + 1 > SETTINGS_STORE_SIZE);
+  CHECK_STR(subtitle(menu, count), "Storage full");
+
+  // a deleted profile makes room for one more
+  shim_menu_select(menu, 0, 0, true);
+  shim_menu_select(menu, 0, 0, false);
+  CHECK_STR(subtitle(menu, count - 1), "");
+  shim_menu_select(menu, 0, count - 1, false);
+  CHECK_EQ(settings_get_num_of_profiles(), count);
+  close_all();
+}
+
+int main(void)
+{
+  settings_init();
+
+  test_delete();
+  test_name();
+  test_full();
+
+  settings_deinit();
+  return TEST_RESULT("test_profiles");
+}
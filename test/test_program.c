@@ -0,0 +1,148 @@
+// Programs run end to end at virtual time: each phase starts where the one
+// before ended, a phase counting up is ended by select, and the heat history
+// adds up the phases of each type.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "raceTimer/raceTimer.c"
+
+#define PHASE(t, d, v)  { .type = (t), .end_vibe = (v), .resolution = TIMER_RES_TENTH, .duration = (d) }
+
+typedef struct {
+  uint32_t  at_ms;        // since the heat was started
+  uint8_t   phase;        // running from then on
+} Step;
+
+// Stored as the program editor leaves it, the profile is made active by
+// the heat that runs it
+static void store_program(uint8_t id, const settings_program_t *program)
+{
+  settings_packed_t packed = { .program = *program };
+
+  persist_write_data(SETTINGS_PROFILE_KEY + id, &packed, sizeof(packed));
+}
+
+static void use_program(uint8_t id)
+{
+  settings_set_active_profile(id);
+  racetimer_event_handler(EVENT_INIT);
+}
+
+// Each phase ends on the ms, not a tick before or after
+static void run_steps(uint64_t start_ms, uint8_t phase, const Step *steps, uint8_t count)
+{
+  for (uint8_t i = 0; i < count; i++)
+  {
+    shim_run_until(start_ms + steps[i].at_ms - 1);
+    CHECK_EQ(s_phase_index, phase);
+    shim_run_until(start_ms + steps[i].at_ms);
+    phase = steps[i].phase;
+    CHECK_EQ(s_phase_index, phase);
+    CHECK_EQ(state, STATE_PHASE_RUNNING);
+  }
+}
+
+static void end_heat(history_heat_t *heat)
+{
+  uint8_t count = history_count();
+
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_STOPPED);
+  CHECK_EQ(history_count(), count + 1);
+  CHECK(history_get(0, heat));
+}
+
+// Staging, warm-up, qualifying, cool-down and the main race
+static const settings_program_t TIMED = {
+  .num_phases = 5,
+  .phases = {
+    PHASE(SETTINGS_PHASE_PRE_RACE,   10, TIMER_VIBE_DOUBLE),
+    PHASE(SETTINGS_PHASE_RACE,       20, TIMER_VIBE_TRIPLE),
+    PHASE(SETTINGS_PHASE_AFTER_RACE,  5, TIMER_VIBE_LONG),
+    PHASE(SETTINGS_PHASE_RACE,       15, TIMER_VIBE_TRIPLE),
+    PHASE(SETTINGS_PHASE_AFTER_RACE,  0, TIMER_VIBE_NONE),
+  },
+};
+
+static void test_timed(void)
+{
+  static const Step STEPS[] = {
+    { 10000, 1 }, { 30000, 2 }, { 35000, 3 }, { 50000, 4 },
+  };
+  history_heat_t heat;
+
+  use_program(0);
+  uint64_t start_ms = shim_now_ms();
+  shim_vibes_clear();
+  shim_click(BUTTON_ID_DOWN, 1);
+  run_steps(start_ms, 0, STEPS, ARRAY_LENGTH(STEPS));
+
+  // the last phase counts up until the heat is ended
+  shim_run_until(start_ms + 80000);
+  CHECK_EQ(s_phase_index, 4);
+  CHECK_EQ(timer_get_elapsed_ms(rctimer), 30000);
+  CHECK_EQ(shim_vibes_count(), 4);
+  end_heat(&heat);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_PRE_RACE], 100);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_RACE], 350);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_AFTER_RACE], 350);
+}
+
+// A staging phase counting up until select, then a race of two timed parts
+static const settings_program_t SELECTED = {
+  .num_phases = 4,
+  .phases = {
+    PHASE(SETTINGS_PHASE_PRE_RACE,    0, TIMER_VIBE_NONE),
+    PHASE(SETTINGS_PHASE_RACE,       10, TIMER_VIBE_SHORT),
+    PHASE(SETTINGS_PHASE_RACE,       10, TIMER_VIBE_TRIPLE),
+    PHASE(SETTINGS_PHASE_AFTER_RACE,  0, TIMER_VIBE_NONE),
+  },
+};
+
+static void test_select(void)
+{
+  static const Step STEPS[] = {
+    { 17000, 2 }, { 27000, 3 },
+  };
+  history_heat_t heat;
+
+  use_program(1);
+  uint64_t start_ms = shim_now_ms();
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_until(start_ms + 7000);
+  CHECK_EQ(s_phase_index, 0);
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_run_for(0);
+  CHECK_EQ(s_phase_index, 1);
+  run_steps(start_ms, 1, STEPS, ARRAY_LENGTH(STEPS));
+
+  // select does not end the last phase
+  shim_run_until(start_ms + 30000);
+  shim_click(BUTTON_ID_SELECT, 1);
+  shim_run_for(0);
+  CHECK_EQ(s_phase_index, 3);
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+  end_heat(&heat);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_PRE_RACE], 70);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_RACE], 200);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_AFTER_RACE], 30);
+}
+
+int main(void)
+{
+  persist_write_int(SETTINGS_VERSION_KEY, SETTINGS_VERSION_CURRENT);
+  persist_write_int(SETTINGS_ACTIVE_KEY, 0);
+  store_program(0, &TIMED);
+  store_program(1, &SELECTED);
+  settings_init();
+  racetimer_init();
+
+  test_timed();
+  test_select();
+
+  window_stack_pop(false);
+  racetimer_deinit();
+  settings_deinit();
+  return TEST_RESULT("test_program");
+}
@@ -0,0 +1,121 @@
+// The progress bar width from the Q48 reciprocal against a plain divide:
+// pixel exact and monotonic for every tick of a 99 minute race, and at every
+// pixel step of totals up to UINT32_MAX, on the bar widths of the watches.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "layers/progress_layer.h"
+
+static const int16_t WIDTHS[] = { 102, 114, 130, 144, 170, 200 };
+
+static int16_t drawn_width(ProgressLayer *layer)
+{
+  shim_fill_clear();
+  shim_layer_draw(layer);
+  // the background, then the bar
+  return shim_fill_rect(1).size.w;
+}
+
+static void test_race(int16_t width)
+{
+  const uint32_t total = 99 * 60 * 10;
+  ProgressLayer *layer = progress_layer_create(GRect(0, 0, width, 20));
+  uint32_t wrong = 0, backwards = 0, redraws = 0;
+  int16_t last = 0;
+
+  progress_layer_set_total(layer, total);
+  progress_layer_set_value(layer, 0);
+  uint32_t dirty = shim_layer_dirty_count(layer);
+
+  for (uint32_t value = 0; value <= total; value++)
+  {
+    bool changed = progress_layer_set_value(layer, value);
+    int16_t px = drawn_width(layer);
+
+    if (px != (int16_t)((uint64_t)value * width / total))
+      wrong++;
+    if (px < last)
+      backwards++;
+    if (changed != (px != last))
+      wrong++;
+    if (changed)
+      redraws++;
+    last = px;
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(backwards, 0);
+  CHECK_EQ(last, width);
+  // marked dirty once per pixel, not per tick
+  CHECK_EQ(redraws, width);
+  CHECK_EQ(shim_layer_dirty_count(layer) - dirty, width);
+
+  progress_layer_destroy(layer);
+}
+
+// Every value of every total up to 10 minutes in tenths
+static void test_totals(int16_t width)
+{
+  ProgressLayer *layer = progress_layer_create(GRect(0, 0, width, 20));
+  uint32_t wrong = 0;
+
+  for (uint32_t total = 1; total <= 6000; total++)
+  {
+    progress_layer_set_total(layer, total);
+    for (uint32_t value = 0; value <= total + 1; value++)
+    {
+      uint32_t expected = (value >= total) ? width : (uint64_t)value * width / total;
+      progress_layer_set_value(layer, value);
+      if (drawn_width(layer) != (int16_t)expected)
+        wrong++;
+    }
+  }
+  CHECK_EQ(wrong, 0);
+
+  progress_layer_set_total(layer, 0);
+  progress_layer_set_value(layer, 100);
+  CHECK_EQ(drawn_width(layer), 0);
+
+  progress_layer_destroy(layer);
+}
+
+// Around each pixel step of long totals: the longest phase in tenths, the
+// largest total the reciprocal takes and the ones divided
+static void test_long_totals(int16_t width)
+{
+  static const uint32_t TOTALS[] = {
+    65536, 65537, 655350, (1UL << 24) - 1, 1UL << 24, 100000000, UINT32_MAX
+  };
+  ProgressLayer *layer = progress_layer_create(GRect(0, 0, width, 20));
+  uint32_t wrong = 0;
+
+  for (uint8_t i = 0; i < ARRAY_LENGTH(TOTALS); i++)
+  {
+    uint32_t total = TOTALS[i];
+    progress_layer_set_total(layer, total);
+    for (int16_t px = 1; px <= width; px++)
+    {
+      // the first value of the step, and the last one before it
+      uint32_t first = ((uint64_t)px * total + width - 1) / width;
+      progress_layer_set_value(layer, first - 1);
+      if (drawn_width(layer) != px - 1)
+        wrong++;
+      progress_layer_set_value(layer, first);
+      if (drawn_width(layer) != px)
+        wrong++;
+    }
+  }
+  CHECK_EQ(wrong, 0);
+
+  progress_layer_destroy(layer);
+}
+
+int main(void)
+{
+  for (uint8_t i = 0; i < ARRAY_LENGTH(WIDTHS); i++)
+  {
+    test_race(WIDTHS[i]);
+    test_totals(WIDTHS[i]);
+    test_long_totals(WIDTHS[i]);
+  }
+  return TEST_RESULT("test_progress_layer");
+}
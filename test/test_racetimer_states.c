@@ -0,0 +1,209 @@
+// Every (state, event) pair of the race timer state machine, in race and
+// lap mode, against the transitions the race timer is meant to have.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "raceTimer/raceTimer.c"
+
+#define IGNORED NUM_STATES
+
+// Next state of each pair, IGNORED if the event is dropped. A paused timer
+// resumes into the state it was paused from.
+static const racetimer_state EXPECTED[2][NUM_STATES][NUM_EVENTS] = {
+  [RACETIMER_MODE] = {
+    [STATE_STOPPED] = {
+      [EVENT_INIT] = STATE_STOPPED, [EVENT_TIMER_EXPIRED] = IGNORED,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_PHASE_RUNNING,
+      [EVENT_CLICK_SELECT] = STATE_STOPPED },
+    [STATE_PAUSED] = {
+      [EVENT_INIT] = IGNORED, [EVENT_TIMER_EXPIRED] = IGNORED,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_PHASE_RUNNING,
+      [EVENT_CLICK_SELECT] = IGNORED },
+    [STATE_PHASE_RUNNING] = {
+      [EVENT_INIT] = IGNORED, [EVENT_TIMER_EXPIRED] = STATE_PHASE_RUNNING,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_PAUSED,
+      [EVENT_CLICK_SELECT] = STATE_PHASE_RUNNING },
+  },
+  [LAPTIMER_MODE] = {
+    [STATE_STOPPED] = {
+      [EVENT_INIT] = STATE_STOPPED, [EVENT_TIMER_EXPIRED] = IGNORED,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_LAP_RUNNING,
+      [EVENT_CLICK_SELECT] = STATE_STOPPED },
+    [STATE_PAUSED] = {
+      [EVENT_INIT] = IGNORED, [EVENT_TIMER_EXPIRED] = IGNORED,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_LAP_RUNNING,
+      [EVENT_CLICK_SELECT] = IGNORED },
+    [STATE_LAP_RUNNING] = {
+      [EVENT_INIT] = IGNORED, [EVENT_TIMER_EXPIRED] = IGNORED,
+      [EVENT_CLICK_UP] = STATE_STOPPED, [EVENT_CLICK_DOWN] = STATE_PAUSED,
+      [EVENT_CLICK_SELECT] = STATE_LAP_RUNNING },
+  },
+};
+
+// States reached in each mode, the others are never entered
+static bool reachable(rctimer_mode_t mode, racetimer_state s)
+{
+  return s == STATE_STOPPED || s == STATE_PAUSED ||
+         s == ((mode == RACETIMER_MODE) ? STATE_PHASE_RUNNING : STATE_LAP_RUNNING);
+}
+
+static void enter(rctimer_mode_t mode, racetimer_state target)
+{
+  if (state != STATE_STOPPED)
+    racetimer_event_handler(EVENT_CLICK_UP);
+  settings_set_mode(mode);
+  racetimer_event_handler(EVENT_INIT);
+
+  if (target != STATE_STOPPED)
+    racetimer_event_handler(EVENT_CLICK_DOWN);
+  if (target == STATE_PAUSED)
+    racetimer_event_handler(EVENT_CLICK_DOWN);
+  CHECK_EQ(state, target);
+}
+
+static void test_pair(rctimer_mode_t mode, racetimer_state from, racetimer_event event)
+{
+  racetimer_state expected = EXPECTED[mode][from][event];
+  bool ignored = (expected == IGNORED);
+
+  enter(mode, from);
+  Window *top = shim_top_window();
+  TimerStatus status = timer_get_status(rctimer);
+  uint8_t phase = s_phase_index;
+  uint16_t laps = laplog_count();
+
+  racetimer_event_handler(event);
+
+  if (ignored)
+  {
+    CHECK_EQ(state, from);
+    CHECK_EQ(timer_get_status(rctimer), status);
+    CHECK_EQ(s_phase_index, phase);
+    CHECK_EQ(laplog_count(), laps);
+  }
+  else
+    CHECK_EQ(state, expected);
+  // only an action changes anything, the table has one for every pair not ignored
+  CHECK_EQ(TRANSITION_TABLE[from][event].action == NULL, ignored);
+
+  if (from == STATE_STOPPED && event == EVENT_CLICK_SELECT)
+  {
+    CHECK(shim_top_window() != top);
+    window_stack_pop(false);
+    shim_run_for(0);
+    CHECK(shim_top_window() == top);
+  }
+  if (from == STATE_PHASE_RUNNING && event == EVENT_TIMER_EXPIRED)
+    CHECK_EQ(s_phase_index, phase + 1);
+  if (from == STATE_LAP_RUNNING && event == EVENT_CLICK_SELECT)
+    CHECK_EQ(laplog_count(), laps + 1);
+}
+
+// The last phase expiring and ending a phase counting up stop the heat
+static void test_program_end(void)
+{
+  enter(RACETIMER_MODE, STATE_PHASE_RUNNING);
+  racetimer_event_handler(EVENT_TIMER_EXPIRED);
+  racetimer_event_handler(EVENT_TIMER_EXPIRED);
+  CHECK_EQ(s_phase_index, 2);
+  CHECK_EQ(s_phase->duration, 0);
+
+  racetimer_event_handler(EVENT_CLICK_SELECT);
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+  racetimer_event_handler(EVENT_TIMER_EXPIRED);
+  CHECK_EQ(state, STATE_STOPPED);
+}
+
+// The buttons go through the queue and the click handlers
+static void test_buttons(void)
+{
+  enter(RACETIMER_MODE, STATE_STOPPED);
+  shim_click(BUTTON_ID_DOWN, 1);
+  CHECK_EQ(state, STATE_STOPPED);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+  CHECK_EQ(timer_get_status(rctimer), TIMER_STATUS_RUNNING);
+
+  // the 5 s before the race and the race expire on their own
+  shim_run_for(5000 + 300 * 1000);
+  CHECK_EQ(s_phase_index, 2);
+
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_STOPPED);
+}
+
+// Holding up resets a running heat once, the repeats after it do not step
+// through the profiles until up is released. Held while stopped it does.
+static void test_hold_up(void)
+{
+  enter(RACETIMER_MODE, STATE_PHASE_RUNNING);
+  uint8_t profile = settings_get_active_profile();
+
+  shim_hold(BUTTON_ID_UP, 4);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_STOPPED);
+  CHECK_EQ(settings_get_active_profile(), profile);
+
+  shim_hold(BUTTON_ID_UP, 2);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_STOPPED);
+  CHECK_EQ(settings_get_active_profile(), (profile + 2) % settings_get_num_of_profiles());
+  settings_set_active_profile(profile);
+}
+
+// The repeat is checked when it is handled: posted behind a start it resets
+// the heat it started, and the repeats after it are dropped
+static void test_hold_up_queued(void)
+{
+  enter(RACETIMER_MODE, STATE_STOPPED);
+  uint8_t profile = settings_get_active_profile();
+
+  shim_click(BUTTON_ID_DOWN, 1);
+  up_repeat_click_handler(NULL, NULL);
+  shim_run_for(500);
+  CHECK_EQ(state, STATE_STOPPED);
+  up_repeat_click_handler(NULL, NULL);
+  shim_run_for(500);
+  CHECK_EQ(settings_get_active_profile(), profile);
+
+  // released with a repeat still queued, the next hold steps again
+  up_repeat_click_handler(NULL, NULL);
+  up_raw_up_handler(NULL, NULL);
+  shim_hold(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  CHECK_EQ(settings_get_active_profile(), (profile + 1) % settings_get_num_of_profiles());
+  settings_set_active_profile(profile);
+}
+
+int main(void)
+{
+  settings_init();
+  racetimer_init();
+  CHECK_EQ(state, STATE_STOPPED);
+
+  for (rctimer_mode_t mode = RACETIMER_MODE; mode <= LAPTIMER_MODE; mode++)
+  {
+    for (racetimer_state from = 0; from < NUM_STATES; from++)
+    {
+      if (!reachable(mode, from))
+        continue;
+      for (racetimer_event event = 0; event < NUM_EVENTS; event++)
+        test_pair(mode, from, event);
+    }
+  }
+  test_program_end();
+  test_buttons();
+  test_hold_up();
+  test_hold_up_queued();
+
+  window_stack_pop(false);
+  racetimer_deinit();
+  settings_deinit();
+  return TEST_RESULT("test_racetimer_states");
+}
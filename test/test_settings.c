@@ -0,0 +1,411 @@
+// Settings storage: each older format is read into V7 profiles and the old
+// keys dropped, a damaged profile index is repaired, the profiles fit the
+// 4 KB store next to the other keys, and the program of the active profile
+// is compiled, checked, when it is loaded and saved.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "settings/settings.c"
+#include "worker_msg.h"
+
+// Keys of the other modules, with the most they store
+#define RACETIMER_SNAPSHOT_KEY 151      // the run state
+#define RACETIMER_SNAPSHOT_SIZE 32
+#define HISTORY_INDEX_KEY      199
+#define HISTORY_CHUNK_KEY      200      // + 8 chunks
+#define HISTORY_INDEX_SIZE     24
+
+// The storage as an older version left it, loaded as at startup
+static void load(int version)
+{
+  if (version != SETTINGS_VERSION_OLD_0)
+    persist_write_int(SETTINGS_VERSION_KEY, version);
+  settings_init();
+}
+
+static void check_current(void)
+{
+  CHECK_EQ(persist_read_int(SETTINGS_VERSION_KEY), SETTINGS_VERSION_CURRENT);
+  CHECK(!persist_exists(SETTINGS_KEY));
+  CHECK(!persist_exists(OLD_SETTINGS_KEY));
+  CHECK(persist_exists(SETTINGS_INDEX_KEY));
+  CHECK(s_program_valid);
+}
+
+static void read_stored(uint8_t id, settings_t *setting)
+{
+  settings_packed_t packed;
+
+  CHECK(settings_read_packed(id, &packed));
+  settings_unpack(&packed, setting);
+}
+
+/******************************************************************************
+  Migrations
+******************************************************************************/
+static void test_v0(void)
+{
+  old_settings_t old = {
+    .pre_race_duration = 10, .pre_race_interval = 2, .pre_race_end_vibe = TIMER_VIBE_DOUBLE,
+    .race_duration = 240, .race_interval = 60, .race_eor_warning = 20, .race_end_vibe = TIMER_VIBE_TRIPLE,
+    .after_race_interval = 30,
+  };
+
+  shim_persist_clear();
+  persist_write_data(OLD_SETTINGS_KEY, &old, sizeof(old));
+  load(SETTINGS_VERSION_OLD_0);
+
+  check_current();
+  CHECK_EQ(settings_get_num_of_profiles(), SETTINGS_LEGACY_PROFILES);
+  CHECK_EQ(settings_get_active_profile(), 0);
+  CHECK_EQ(settings()->pre_race_duration, 10);
+  CHECK_EQ(settings()->pre_race_interval, 2);
+  CHECK_EQ(settings()->pre_race_over_vibe, TIMER_VIBE_DOUBLE);
+  CHECK_EQ(settings()->race_duration, 240);
+  CHECK_EQ(settings()->race_over_warning, 20);
+  CHECK_EQ(settings()->race_over_vibe, TIMER_VIBE_TRIPLE);
+  CHECK_EQ(settings()->after_race_interval, 30);
+  CHECK_EQ(settings()->race_resolution, TIMER_RES_TENTH);
+  CHECK_EQ(settings()->after_race_resolution, TIMER_RES_SECOND);
+
+  // the classic program of the profile
+  const settings_program_t *program = settings_program();
+  CHECK_EQ(program->num_phases, 3);
+  CHECK_EQ(program->phases[0].type, SETTINGS_PHASE_PRE_RACE);
+  CHECK_EQ(program->phases[0].duration, 10);
+  CHECK_EQ(program->phases[1].type, SETTINGS_PHASE_RACE);
+  CHECK_EQ(program->phases[1].duration, 240);
+  CHECK_EQ(program->phases[1].warning, 20);
+  CHECK_EQ(program->phases[2].type, SETTINGS_PHASE_AFTER_RACE);
+  CHECK_EQ(program->phases[2].duration, 0);
+  CHECK_EQ(program->phases[2].interval, 30);
+}
+
+static void test_v2(void)
+{
+  profile_setting_v2_t v2 = { .active = 2 };
+
+  for (uint8_t i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+  {
+    v2.settings[i] = (settings_v2_t) {
+      .pre_race_duration = 5, .race_duration = 100 + i, .race_interval = 10,
+      .race_over_vibe = TIMER_VIBE_LONG, .after_race_interval = 20,
+    };
+  }
+  shim_persist_clear();
+  persist_write_data(SETTINGS_KEY, &v2, sizeof(v2));
+  load(SETTINGS_VERSION_2);
+
+  check_current();
+  CHECK_EQ(settings_get_active_profile(), 2);
+  CHECK_EQ(settings()->race_duration, 102);
+  CHECK_EQ(settings()->race_over_vibe, TIMER_VIBE_LONG);
+  CHECK_EQ(settings()->pre_race_resolution, TIMER_RES_TENTH);
+  for (uint8_t i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+  {
+    settings_t stored;
+    read_stored(i, &stored);
+    CHECK_EQ(stored.race_duration, 100 + i);
+  }
+}
+
+static void test_v3(void)
+{
+  profile_setting_v3_t v3 = { .active = 4 };
+
+  for (uint8_t i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+  {
+    v3.settings[i] = (settings_v3_t) {
+      .pre_race_duration = 0, .race_duration = 200 + i, .race_over_warning = 10,
+      .pre_race_resolution = TIMER_RES_SECOND, .race_resolution = TIMER_RES_SECOND,
+      .after_race_resolution = TIMER_RES_TENTH,
+    };
+  }
+  shim_persist_clear();
+  persist_write_data(SETTINGS_KEY, &v3, sizeof(v3));
+  load(SETTINGS_VERSION_3);
+
+  check_current();
+  CHECK_EQ(settings_get_active_profile(), 4);
+  CHECK_EQ(settings()->race_duration, 204);
+  CHECK_EQ(settings()->race_resolution, TIMER_RES_SECOND);
+  CHECK_EQ(settings()->after_race_resolution, TIMER_RES_TENTH);
+
+  // no pre race phase without its duration
+  const settings_program_t *program = settings_program();
+  CHECK_EQ(program->num_phases, 2);
+  CHECK_EQ(program->phases[0].type, SETTINGS_PHASE_RACE);
+  CHECK_EQ(program->phases[0].resolution, TIMER_RES_SECOND);
+  CHECK_EQ(program->phases[1].resolution, TIMER_RES_TENTH);
+}
+
+static void test_v4(void)
+{
+  shim_persist_clear();
+  for (uint8_t i = 0; i < SETTINGS_LEGACY_PROFILES; i++)
+  {
+    settings_packed_v4_t v4 = {
+      .pre_race_duration = 5, .race_duration = 300 + i, .race_over_warning = 15,
+      .vibes = TIMER_VIBE_SHORT | (TIMER_VIBE_DOUBLE << 4), .resolution = 0x02,
+    };
+    persist_write_data(SETTINGS_PROFILE_KEY + i, &v4, sizeof(v4));
+  }
+  persist_write_int(SETTINGS_ACTIVE_KEY, 3);
+  load(SETTINGS_VERSION_4);
+
+  check_current();
+  CHECK_EQ(settings_get_active_profile(), 3);
+  CHECK_EQ(settings()->race_duration, 303);
+  CHECK_EQ(settings()->pre_race_over_vibe, TIMER_VIBE_SHORT);
+  CHECK_EQ(settings()->race_over_vibe, TIMER_VIBE_DOUBLE);
+  CHECK_EQ(settings()->pre_race_resolution, 0);
+  CHECK_EQ(settings()->race_resolution, 1);
+  CHECK_EQ(settings()->race_alerts[0], 0);
+  CHECK_STR(settings()->name, "");
+  CHECK_EQ(settings()->program.num_phases, 0);
+}
+
+static void test_v5(void)
+{
+  settings_packed_v5_t v5 = {
+    .race_duration = 120, .race_interval = 30, .race_alerts = { 90, 45 },
+  };
+
+  shim_persist_clear();
+  persist_write_data(SETTINGS_PROFILE_KEY + 1, &v5, sizeof(v5));
+  persist_write_int(SETTINGS_ACTIVE_KEY, 1);
+  load(SETTINGS_VERSION_5);
+
+  check_current();
+  CHECK_EQ(settings_get_active_profile(), 1);
+  CHECK_EQ(settings()->race_duration, 120);
+  CHECK_EQ(settings()->race_alerts[0], 90);
+  CHECK_EQ(settings()->race_alerts[1], 45);
+  CHECK_EQ(settings_program()->phases[0].alerts[1], 45);
+
+  // the profiles not stored get the defaults
+  settings_set_active_profile(0);
+  CHECK_EQ(settings()->race_duration, 300);
+}
+
+static void test_v6(void)
+{
+  settings_index_t index = { .count = 2, .ids = { 7, 3 } };
+  settings_packed_v6_t v6 = { .race_duration = 180, .name = "HEAT" };
+
+  shim_persist_clear();
+  persist_write_data(SETTINGS_INDEX_KEY, &index, 1 + index.count);
+  persist_write_data(SETTINGS_PROFILE_KEY + 3, &v6, sizeof(v6));
+  persist_write_int(SETTINGS_ACTIVE_KEY, 1);
+  load(SETTINGS_VERSION_6);
+
+  CHECK_EQ(persist_read_int(SETTINGS_VERSION_KEY), SETTINGS_VERSION_CURRENT);
+  CHECK(s_program_valid);
+  CHECK_EQ(settings_get_num_of_profiles(), 2);
+  CHECK_EQ(settings_get_active_profile(), 1);
+  CHECK_EQ(settings_get_active_profile_id(), 3);
+  CHECK_EQ(settings()->race_duration, 180);
+  CHECK_STR(settings()->name, "HEAT");
+  CHECK_EQ(settings_program()->num_phases, 2);
+}
+
+/******************************************************************************
+  Profile index
+******************************************************************************/
+static void load_index(const uint8_t *data, size_t size)
+{
+  shim_persist_clear();
+  persist_write_data(SETTINGS_INDEX_KEY, data, size);
+  persist_write_int(SETTINGS_ACTIVE_KEY, 0);
+  load(SETTINGS_VERSION_CURRENT);
+}
+
+// Ids past the profile keys and repeated ids are dropped, a count past the
+// ids stored is cut and with no valid id left the default profile is used
+static void test_index(void)
+{
+  static const uint8_t mixed[] = { 6, 3, SETTINGS_MAX_PROFILES, 3, 150, 7, 1 };
+  static const uint8_t short_count[] = { 9, 2, 4 };
+  static const uint8_t invalid[] = { 2, SETTINGS_MAX_PROFILES, 255 };
+  settings_index_t stored;
+
+  load_index(mixed, sizeof(mixed));
+  CHECK_EQ(settings_get_num_of_profiles(), 3);
+  CHECK_EQ(s_index.ids[0], 3);
+  CHECK_EQ(s_index.ids[1], 7);
+  CHECK_EQ(s_index.ids[2], 1);
+  settings_deinit();
+  CHECK_EQ(persist_read_data(SETTINGS_INDEX_KEY, &stored, sizeof(stored)), 4);
+
+  load_index(short_count, sizeof(short_count));
+  CHECK_EQ(settings_get_num_of_profiles(), 2);
+  CHECK_EQ(settings_get_active_profile_id(), 2);
+  settings_deinit();
+
+  load_index(invalid, sizeof(invalid));
+  CHECK_EQ(settings_get_num_of_profiles(), 1);
+  CHECK_EQ(settings_get_active_profile_id(), 0);
+  CHECK_EQ(settings()->race_duration, 300);
+  CHECK(s_program_valid);
+  settings_deinit();
+}
+
+/******************************************************************************
+  Storage budget
+******************************************************************************/
+// The other keys as an app used for long leaves them, a full history, the
+// run state and the worker heat, and one profile
+static void store_other_keys(void)
+{
+  static const uint8_t data[PERSIST_DATA_MAX_LENGTH] = { 0 };
+  static const uint8_t index[] = { 1, 0 };
+
+  shim_persist_clear();
+  for (uint8_t i = 0; i < 8; i++)
+    persist_write_data(HISTORY_CHUNK_KEY + i, data, PERSIST_DATA_MAX_LENGTH);
+  persist_write_data(HISTORY_INDEX_KEY, data, HISTORY_INDEX_SIZE);
+  persist_write_data(WORKER_HEAT_KEY, data, sizeof(worker_heat_t));
+  persist_write_data(RACETIMER_SNAPSHOT_KEY, data, RACETIMER_SNAPSHOT_SIZE);
+  persist_write_data(SETTINGS_INDEX_KEY, index, sizeof(index));
+  persist_write_int(SETTINGS_ACTIVE_KEY, 0);
+  CHECK(shim_persist_used() + SETTINGS_STORE_SIZE <= SHIM_PERSIST_SIZE);
+}
+
+static void check_stored(uint8_t num_phases)
+{
+  settings_t stored;
+
+  CHECK(shim_persist_used() <= SHIM_PERSIST_SIZE);
+  for (uint8_t i = 0; i < s_index.count; i++)
+  {
+    read_stored(s_index.ids[i], &stored);
+    CHECK_EQ(stored.program.num_phases, num_phases);
+    CHECK_EQ(stored.program.phases[num_phases - 1].duration, 20);
+  }
+}
+
+// Copies of a program of num_phases phases are added until one is refused
+static void fill_programs(uint8_t num_phases)
+{
+  store_other_keys();
+  load(SETTINGS_VERSION_CURRENT);
+  while (settings_program()->num_phases < num_phases)
+    settings_add_phase();
+  settings_edit_phase(num_phases - 1)->duration = 20;
+  while (settings_add_profile())
+    ;
+  CHECK(settings_get_num_of_profiles() > 1);
+  settings_save();
+  check_stored(num_phases);
+}
+
+// Profiles are added until one is refused, in a store of 4 KB that already
+// holds a full history. Classic profiles edited into programs of their own
+// and profiles of eight phases are all stored.
+static void test_store_full(void)
+{
+  store_other_keys();
+  load(SETTINGS_VERSION_CURRENT);
+  while (settings_add_profile())
+    ;
+  CHECK_EQ(settings_get_num_of_profiles(), SETTINGS_MAX_PROFILES);
+  for (uint8_t i = 0; i < SETTINGS_MAX_PROFILES; i++)
+  {
+    settings_set_active_profile(i);
+    settings_edit_phase(2)->duration = 20;
+  }
+  settings_save();
+  check_stored(3);
+  settings_deinit();
+
+  fill_programs(SETTINGS_MAX_PHASES);
+  settings_deinit();
+
+  // with the store full of programs of seven phases an eighth does not fit
+  fill_programs(SETTINGS_MAX_PHASES - 1);
+  CHECK(!settings_add_phase());
+  CHECK_EQ(settings_program()->num_phases, SETTINGS_MAX_PHASES - 1);
+  settings_deinit();
+  check_stored(SETTINGS_MAX_PHASES - 1);
+}
+
+/******************************************************************************
+  Program compile
+******************************************************************************/
+// The phases are checked when the profile is loaded, out of range values
+// are wrapped, a warning longer than its phase is cut and a program longer
+// than the phases held is cut
+static void test_compile_load(void)
+{
+  settings_packed_t packed = {
+    .program = {
+      .num_phases = SETTINGS_MAX_PHASES + 4,
+      .phases = {
+        { .type = SETTINGS_NUM_PHASE_TYPES + 1, .end_vibe = TIMER_VIBE_MAX + 2,
+          .resolution = TIMER_RES_MAX + 1, .duration = 30, .warning = 100 },
+        { .type = SETTINGS_PHASE_AFTER_RACE, .warning = 100 },
+      },
+    },
+  };
+
+  shim_persist_clear();
+  persist_write_int(SETTINGS_ACTIVE_KEY, 0);
+  persist_write_data(SETTINGS_PROFILE_KEY, &packed, sizeof(packed));
+  load(SETTINGS_VERSION_CURRENT);
+
+  CHECK(s_program_valid);
+  CHECK_EQ(s_program.num_phases, SETTINGS_MAX_PHASES);
+  CHECK_EQ(s_program.phases[0].type, 1);
+  CHECK_EQ(s_program.phases[0].end_vibe, 2);
+  CHECK_EQ(s_program.phases[0].resolution, 1);
+  CHECK_EQ(s_program.phases[0].warning, 30);
+  CHECK_EQ(s_program.phases[1].warning, 100);
+
+  // the profile keeps what was stored, only the compiled program is checked
+  CHECK_EQ(settings()->program.phases[0].warning, 100);
+}
+
+// A change is compiled when saved, before a heat asks for the program
+static void test_compile_save(void)
+{
+  shim_persist_clear();
+  load(SETTINGS_VERSION_CURRENT);
+
+  settings_edit_phase(1)->duration = 42;
+  CHECK(s_dirty);
+  CHECK(!s_program_valid);
+  settings_save();
+  CHECK(s_program_valid);
+  CHECK_EQ(s_program.phases[1].duration, 42);
+
+  settings_add_phase();
+  settings_edit_phase(3)->duration = 10;
+  settings_edit_phase(3)->warning = 50;
+  settings_save();
+  CHECK(s_program_valid);
+  CHECK_EQ(s_program.num_phases, 4);
+  CHECK_EQ(s_program.phases[3].warning, 10);
+
+  // a profile selected is compiled when loaded
+  settings_set_active_profile(1);
+  CHECK(s_program_valid);
+  CHECK_EQ(s_program.num_phases, 3);
+  settings_set_active_profile(0);
+  CHECK(s_program_valid);
+  CHECK_EQ(s_program.num_phases, 4);
+}
+
+int main(void)
+{
+  test_v0();
+  test_v2();
+  test_v3();
+  test_v4();
+  test_v5();
+  test_v6();
+  test_index();
+  test_store_full();
+  test_compile_load();
+  test_compile_save();
+  return TEST_RESULT("test_settings");
+}
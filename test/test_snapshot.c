@@ -0,0 +1,103 @@
+// The run state snapshot: a heat goes on when the app is closed and opened
+// again, on the profile it was started with, and a heat left for longer than
+// the history can hold is recorded, not lost.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "raceTimer/raceTimer.c"
+
+// A new process, the state starts over
+static void app_open(void)
+{
+  state = prev_state = STATE_STOPPED;
+  racetimer_init();
+}
+
+static void app_close(void)
+{
+  window_stack_pop(false);
+  racetimer_deinit();
+}
+
+static void stop(void)
+{
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  CHECK_EQ(state, STATE_STOPPED);
+}
+
+// Default profile: a 5 s pre race, a 300 s race, an after race counting up
+static void test_relaunch(void)
+{
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(20 * 1000);
+  app_close();
+  shim_run_for(100 * 1000);
+  app_open();
+
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+  CHECK_EQ(s_phase_index, 1);
+  CHECK_EQ(timer_get_elapsed_ms(rctimer) / 1000, 115);
+  stop();
+}
+
+// The profiles before the active one are deleted while the app is closed
+static void test_profile_id(void)
+{
+  settings_set_active_profile(2);
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(1000);
+  app_close();
+  CHECK(settings_delete_profile(0));
+  CHECK_EQ(settings_get_active_profile(), 1);
+  app_open();
+  CHECK_EQ(state, STATE_PHASE_RUNNING);
+  stop();
+
+  // another profile made active does not take the heat over
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(1000);
+  app_close();
+  settings_set_active_profile(0);
+  app_open();
+  CHECK_EQ(state, STATE_STOPPED);
+}
+
+// Left in the after race phase for 2 hours, more than its 0.1 sec history
+// time holds
+static void test_long_heat(void)
+{
+  history_heat_t heat;
+  uint8_t count = history_count();
+  uint32_t start = time(NULL);
+
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(310 * 1000);
+  CHECK_EQ(s_phase_index, 2);
+  app_close();
+  shim_run_for(2 * 3600 * 1000);
+  app_open();
+
+  CHECK_EQ(state, STATE_STOPPED);
+  CHECK_EQ(history_count(), count + 1);
+  CHECK(history_get(0, &heat));
+  CHECK_EQ(heat.start, start);
+  CHECK_EQ(heat.mode, RACETIMER_MODE);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_PRE_RACE], 50);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_RACE], 3000);
+  CHECK_EQ(heat.phase[HISTORY_PHASE_AFTER_RACE], UINT16_MAX);
+}
+
+int main(void)
+{
+  settings_init();
+  app_open();
+
+  test_relaunch();
+  test_profile_id();
+  test_long_heat();
+
+  app_close();
+  settings_deinit();
+  return TEST_RESULT("test_snapshot");
+}
@@ -0,0 +1,111 @@
+// The time formatter against the snprintf formats it replaced, for every
+// tenth from 0:00.0 to 99:59.9, and how long both take.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "timer.h"
+
+#define RANGE (100 * 60 * 10)
+
+static void reference(uint32_t t, bool show_minutes, TimerResolution res, char *str, int len)
+{
+  int tenths = t % 10;
+  int seconds = (t / 10) % 60;
+  int minutes = t / 600;
+
+  if (show_minutes && res == TIMER_RES_SECOND)
+    snprintf(str, len, "%2d:%02d", minutes, seconds);
+  else if (show_minutes)
+    snprintf(str, len, "%2d:%02d.%01d", minutes, seconds, tenths);
+  else if (res == TIMER_RES_SECOND)
+    snprintf(str, len, "%2d", seconds);
+  else
+    snprintf(str, len, "%2d.%01d", seconds, tenths);
+}
+
+static void test_equal(void)
+{
+  char expected[16], actual[16];
+  uint32_t wrong = 0;
+
+  for (int show = 0; show <= 1; show++)
+  {
+    for (TimerResolution res = TIMER_RES_TENTH; res < TIMER_RES_MAX; res++)
+    {
+      for (uint32_t t = 0; t < RANGE; t++)
+      {
+        reference(t, show, res, expected, sizeof(expected));
+        memset(actual, 'x', sizeof(actual));
+        uint8_t len = timer_time_format(t, show, res, actual, sizeof(actual));
+        if (strcmp(actual, expected) != 0 || len != strlen(expected))
+          wrong++;
+      }
+    }
+  }
+  CHECK_EQ(wrong, 0);
+
+  // whole seconds, minutes above 99 get more digits
+  for (uint32_t t = 0; t < 200 * 60; t++)
+  {
+    snprintf(expected, sizeof(expected), "%02d:%02d", (int)(t / 60), (int)(t % 60));
+    timer_time_str(t, actual, sizeof(actual));
+    if (strcmp(actual, expected) != 0)
+      wrong++;
+  }
+  CHECK_EQ(wrong, 0);
+}
+
+// A short buffer is cut like snprintf cuts it
+static void test_truncate(void)
+{
+  char expected[16], actual[16];
+
+  for (int len = 1; len <= 10; len++)
+  {
+    reference(59999, true, TIMER_RES_TENTH, expected, len);
+    uint8_t written = timer_time_format(59999, true, TIMER_RES_TENTH, actual, len);
+    CHECK_STR(actual, expected);
+    CHECK_EQ(written, strlen(expected));
+  }
+}
+
+static void benchmark(void)
+{
+  char str[16];
+  volatile char sink = 0;
+  clock_t start;
+  double snprintf_s, format_s;
+
+  start = clock();
+  for (int round = 0; round < 10; round++)
+  {
+    for (uint32_t t = 0; t < RANGE; t++)
+    {
+      reference(t, true, TIMER_RES_TENTH, str, sizeof(str));
+      sink += str[4];
+    }
+  }
+  snprintf_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  start = clock();
+  for (int round = 0; round < 10; round++)
+  {
+    for (uint32_t t = 0; t < RANGE; t++)
+    {
+      timer_time_format(t, true, TIMER_RES_TENTH, str, sizeof(str));
+      sink += str[4];
+    }
+  }
+  format_s = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+  fprintf(stderr, "%d calls: snprintf %.1f ns/call, timer_time_format %.1f ns/call\n",
+          10 * RANGE, snprintf_s * 1e9 / (10 * RANGE), format_s * 1e9 / (10 * RANGE));
+}
+
+int main(void)
+{
+  test_equal();
+  test_truncate();
+  benchmark();
+  return TEST_RESULT("test_time_format");
+}
@@ -0,0 +1,133 @@
+// Timer against the virtual clock: the time shown, pause and resume and the
+// expiry follow the clock exactly, whenever the wakeups come.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "timer.h"
+
+static uint32_t s_updates = 0;
+static uint32_t s_expired = 0;
+static uint64_t s_expired_at = 0;
+
+static void update_cb(void* context)
+{
+  s_updates++;
+}
+
+static void expired_cb(void* context)
+{
+  s_expired++;
+  s_expired_at = shim_now_ms();
+}
+
+static void test_stopwatch(void)
+{
+  Timer timer = timer_create();
+  timer_set_length(timer, 0);
+  timer_set_display_resolution(timer, TIMER_RES_TENTH);
+  timer_register_update_cb(timer, update_cb, NULL);
+
+  timer_start(timer);
+  shim_run_for(10550);
+  CHECK_EQ(timer_get_status(timer), TIMER_STATUS_RUNNING);
+  CHECK_EQ(timer_get_time(timer), 105);
+  CHECK_EQ(timer_get_elapsed_ms(timer), 10550);
+  CHECK_EQ(s_updates, 105);
+
+  // the time stands while paused
+  timer_pause(timer);
+  shim_run_for(5000);
+  CHECK_EQ(timer_get_elapsed_ms(timer), 10550);
+  CHECK_EQ(shim_timers_pending(), 0);
+
+  timer_resume(timer);
+  shim_run_for(1450);
+  CHECK_EQ(timer_get_time(timer), 120);
+  CHECK_EQ(timer_get_elapsed_ms(timer), 12000);
+
+  timer_destroy(timer);
+  CHECK_EQ(shim_timers_pending(), 0);
+}
+
+static void test_countdown(void)
+{
+  Timer timer = timer_create();
+  timer_set_length(timer, 60);
+  timer_set_display_resolution(timer, TIMER_RES_SECOND);
+  timer_register_expired_cb(timer, expired_cb, NULL);
+
+  uint64_t start = shim_now_ms();
+  timer_start(timer);
+  shim_run_for(30000);
+  CHECK_EQ(timer_get_time(timer), 300);
+
+  shim_run_for(40000);
+  CHECK_EQ(timer_get_status(timer), TIMER_STATUS_DONE);
+  CHECK_EQ(timer_get_time(timer), 0);
+  CHECK_EQ(s_expired, 1);
+  CHECK_EQ(s_expired_at - start, 60000);
+
+  timer_destroy(timer);
+}
+
+// A relaunched heat continues from the elapsed time it had
+static void test_set_elapsed(void)
+{
+  Timer timer = timer_create();
+  timer_set_length(timer, 120);
+
+  timer_start(timer);
+  timer_set_elapsed_ms(timer, 45250);
+  CHECK_EQ(timer_get_time(timer), 1200 - 452);
+  shim_run_for(750);
+  CHECK_EQ(timer_get_elapsed_ms(timer), 46000);
+  CHECK_EQ(timer_get_time(timer), 1200 - 460);
+
+  timer_destroy(timer);
+}
+
+// The alert points are given from the elapsed time a timer is moved to,
+// forward or back, running or paused, and a new table starts over
+static void test_alert_points(void)
+{
+  static const uint16_t FIRST[] = { 50, 40, 30 };
+  static const uint16_t SECOND[] = { 15 };
+  Timer timer = timer_create();
+  timer_set_length(timer, 60);
+  timer_set_alert_points(timer, FIRST, ARRAY_LENGTH(FIRST));
+
+  shim_vibes_clear();
+  timer_start(timer);
+  timer_set_elapsed_ms(timer, 15000);
+  shim_run_for(20000);
+  CHECK_EQ(shim_vibes_count(), 2);
+
+  // back over both, they are given again
+  timer_pause(timer);
+  timer_set_elapsed_ms(timer, 5000);
+  timer_resume(timer);
+  shim_run_for(26000);
+  CHECK_EQ(shim_vibes_count(), 5);
+
+  timer_reset(timer);
+  timer_set_length(timer, 60);
+  timer_set_alert_points(timer, SECOND, ARRAY_LENGTH(SECOND));
+  uint64_t start = shim_now_ms();
+  timer_start(timer);
+  timer_set_elapsed_ms(timer, 40000);
+  shim_run_for(10000);
+  CHECK_EQ(shim_vibes_count(), 6);
+  if (shim_vibes_count() == 6)
+    CHECK_EQ(shim_vibe(5)->at_ms - start, 5000);
+
+  timer_destroy(timer);
+}
+
+int main(void)
+{
+  test_stopwatch();
+  test_countdown();
+  test_set_elapsed();
+  test_alert_points();
+  return TEST_RESULT("test_timer");
+}
@@ -0,0 +1,88 @@
+// A 30 minute run with every wakeup late by up to 80 ms: the time shown is
+// always the time read from the clock, the error does not add up.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "timer.h"
+
+#define RUN_MS      (30 * 60 * 1000)
+#define MAX_LATE_MS 80
+
+static Timer s_timer;
+static uint64_t s_start;
+static uint32_t s_updates = 0;
+static uint32_t s_wrong = 0;
+static uint64_t s_expired_at = 0;
+
+// The shown time is the clock time rounded down to the tick, counting up or
+// down, and is never more than one wakeup late
+static void update_cb(void* context)
+{
+  uint32_t elapsed = (shim_now_ms() - s_start) / 100;
+  uint32_t length = *(uint32_t*)context;
+  uint32_t expected = length ? length - elapsed : elapsed;
+
+  s_updates++;
+  if (timer_get_time(s_timer) != expected)
+    s_wrong++;
+}
+
+static void expired_cb(void* context)
+{
+  s_expired_at = shim_now_ms();
+}
+
+static void test_stopwatch(void)
+{
+  uint32_t length = 0;
+
+  s_timer = timer_create();
+  timer_set_length(s_timer, 0);
+  timer_set_display_resolution(s_timer, TIMER_RES_TENTH);
+  timer_register_update_cb(s_timer, update_cb, &length);
+
+  s_start = shim_now_ms();
+  timer_start(s_timer);
+  shim_run_for(RUN_MS + MAX_LATE_MS);
+
+  // the last wakeup came in time for the 30th minute
+  CHECK_EQ(timer_get_elapsed_ms(s_timer), RUN_MS + MAX_LATE_MS);
+  CHECK_EQ(timer_get_time(s_timer), RUN_MS / 100);
+  CHECK_EQ(s_wrong, 0);
+  // late wakeups may skip a tenth, never many
+  CHECK(s_updates > RUN_MS / 100 * 9 / 10);
+
+  timer_destroy(s_timer);
+}
+
+static void test_countdown(void)
+{
+  uint32_t length = RUN_MS / 100;
+
+  s_updates = s_wrong = 0;
+  s_timer = timer_create();
+  timer_set_length(s_timer, RUN_MS / 1000);
+  timer_set_display_resolution(s_timer, TIMER_RES_SECOND);
+  timer_set_interval_vibration(s_timer, 60);
+  timer_register_update_cb(s_timer, update_cb, &length);
+  timer_register_expired_cb(s_timer, expired_cb, NULL);
+
+  s_start = shim_now_ms();
+  timer_start(s_timer);
+  shim_run_for(RUN_MS + 1000);
+
+  CHECK_EQ(timer_get_status(s_timer), TIMER_STATUS_DONE);
+  CHECK_EQ(s_wrong, 0);
+  CHECK(s_expired_at >= s_start + RUN_MS);
+  CHECK(s_expired_at <= s_start + RUN_MS + MAX_LATE_MS);
+
+  timer_destroy(s_timer);
+}
+
+int main(void)
+{
+  shim_set_jitter(MAX_LATE_MS, 2024);
+  test_stopwatch();
+  test_countdown();
+  return TEST_RESULT("test_timer_drift");
+}
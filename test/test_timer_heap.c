@@ -0,0 +1,163 @@
+// The shared wakeup: the heap stays ordered by deadline whatever the timers
+// do, close deadlines share a wakeup, every timer created has a place in it,
+// and the wakeups per second do not grow with the number of running timers.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "timer.c"
+
+static unsigned int s_seed = 7;
+
+static uint32_t test_rand(uint32_t n)
+{
+  s_seed = s_seed * 1103515245u + 12345u;
+  return (s_seed >> 16) % n;
+}
+
+// Every parent is due before its children and knows its position
+static bool heap_valid(void)
+{
+  for (uint8_t i = 0; i < s_heap_count; i++)
+  {
+    if (s_heap[i]->heap_pos != i + 1)
+      return false;
+    if (i > 0 && timer_before(s_heap[i], s_heap[(i - 1) / 2]))
+      return false;
+  }
+  return true;
+}
+
+static void test_heap_order(void)
+{
+  sTimer timers[TIMER_MAX_RUNNING];
+  uint32_t base = 0xFFFFF000;   // deadlines wrap around
+
+  memset(timers, 0, sizeof(timers));
+  for (uint32_t round = 0; round < 10000; round++)
+  {
+    sTimer *timer = &timers[test_rand(TIMER_MAX_RUNNING)];
+    switch (test_rand(3))
+    {
+      case 0:
+      case 1:
+        timer_heap_remove(timer);
+        timer->deadline_ms = base + test_rand(8192);
+        timer_heap_push(timer);
+        break;
+      case 2:
+        timer_heap_remove(timer);
+        break;
+    }
+    CHECK(heap_valid());
+  }
+
+  // they come out in deadline order
+  while (s_heap_count > 0)
+  {
+    sTimer *first = s_heap[0];
+    timer_heap_remove(first);
+    CHECK(s_heap_count == 0 || !timer_before(s_heap[0], first));
+    CHECK(heap_valid());
+  }
+}
+
+// Timers due within TIMER_COALESCE_MS of each other are served together
+static void test_coalesce(void)
+{
+  Timer a = timer_create(), b = timer_create(), c = timer_create();
+  timer_set_display_resolution(a, TIMER_RES_TENTH);
+  timer_set_display_resolution(b, TIMER_RES_TENTH);
+  timer_set_display_resolution(c, TIMER_RES_TENTH);
+
+  timer_start(a);
+  shim_run_for(20);
+  timer_start(b);
+  shim_run_for(20);
+  timer_start(c);
+  CHECK(heap_valid());
+  CHECK_EQ(shim_timers_pending(), 1);
+
+  // a at 100, b at 120 and c at 140 ms: one wakeup at 140
+  uint32_t wakeups = shim_wakeups();
+  shim_run_for(100);
+  CHECK_EQ(shim_wakeups() - wakeups, 1);
+  CHECK_EQ(timer_get_time(a), 1);
+  CHECK_EQ(timer_get_time(b), 1);
+  CHECK_EQ(timer_get_time(c), 1);
+
+  timer_destroy(a);
+  timer_destroy(b);
+  timer_destroy(c);
+  CHECK_EQ(s_heap_count, 0);
+  CHECK_EQ(shim_timers_pending(), 0);
+}
+
+// Every timer that can be created can run, the one too many is refused
+static void test_limit(void)
+{
+  Timer timers[TIMER_MAX_RUNNING];
+
+  for (uint8_t i = 0; i < TIMER_MAX_RUNNING; i++)
+  {
+    timers[i] = timer_create();
+    CHECK(timers[i] != NULL);
+    timer_start(timers[i]);
+  }
+  CHECK(timer_create() == NULL);
+  CHECK_EQ(s_heap_count, TIMER_MAX_RUNNING);
+  CHECK(heap_valid());
+
+  shim_run_for(1000);
+  for (uint8_t i = 0; i < TIMER_MAX_RUNNING; i++)
+    CHECK_EQ(timer_get_elapsed_ms(timers[i]), 1000);
+
+  timer_destroy(timers[0]);
+  timers[0] = timer_create();
+  CHECK(timers[0] != NULL);
+  for (uint8_t i = 0; i < TIMER_MAX_RUNNING; i++)
+    timer_destroy(timers[i]);
+  CHECK_EQ(s_heap_count, 0);
+}
+
+// Wakeups per second of count timers started at random offsets, each
+// showing tenths
+static uint32_t wakeups_per_second(uint8_t count)
+{
+  Timer timers[TIMER_MAX_RUNNING];
+
+  for (uint8_t i = 0; i < count; i++)
+  {
+    timers[i] = timer_create();
+    timer_set_display_resolution(timers[i], TIMER_RES_TENTH);
+    timer_start(timers[i]);
+    shim_run_for(test_rand(100));
+  }
+
+  uint32_t wakeups = shim_wakeups();
+  shim_run_for(60 * 1000);
+  wakeups = (shim_wakeups() - wakeups) / 60;
+
+  for (uint8_t i = 0; i < count; i++)
+    timer_destroy(timers[i]);
+  return wakeups;
+}
+
+int main(void)
+{
+  test_heap_order();
+  test_coalesce();
+  test_limit();
+
+  // one timer wakes 10 times a second. More timers at random phases are not
+  // aligned, they take 10 to 20, never more than twice one.
+  uint32_t one = wakeups_per_second(1);
+  CHECK_EQ(one, 10);
+  fprintf(stderr, "timers  wakeups/s\n");
+  for (uint8_t count = 1; count <= TIMER_MAX_RUNNING; count++)
+  {
+    uint32_t wakeups = wakeups_per_second(count);
+    fprintf(stderr, "%6d  %9u\n", count, (unsigned)wakeups);
+    CHECK(wakeups <= 2 * one);
+  }
+  return TEST_RESULT("test_timer_heap");
+}
@@ -0,0 +1,89 @@
+// The static timer pool: creating and destroying timers 100000 times never
+// touches the heap, a new timer is always zeroed and the pool runs out
+// cleanly.
+
+#include "pebble_shim.h"
+#include "test.h"
+
+// timer.c gets these for malloc and free, with the pool it must not call them
+static int32_t s_heap_live = 0;
+static uint32_t s_heap_calls = 0;
+
+void* counted_malloc(size_t size)
+{
+  s_heap_live++;
+  s_heap_calls++;
+  return malloc(size);
+}
+
+void counted_free(void *ptr)
+{
+  if (ptr)
+    s_heap_live--;
+  free(ptr);
+}
+
+#define TIMER_POOL_SIZE 4
+#define malloc(size) counted_malloc(size)
+#define free(ptr) counted_free(ptr)
+#include "timer.c"
+#undef malloc
+#undef free
+
+static void test_stress(void)
+{
+  for (uint32_t i = 0; i < 100000; i++)
+  {
+    Timer timer = timer_create();
+    CHECK(timer != NULL);
+    timer_set_length(timer, i % 100);
+    timer_start(timer);
+    if (i % 3 == 0)
+      shim_run_for(100);
+    timer_destroy(timer);
+  }
+  CHECK_EQ(s_heap_calls, 0);
+  CHECK_EQ(s_heap_live, 0);
+  CHECK_EQ(s_pool_used, 0);
+  CHECK_EQ(s_pool_peak, 1);
+  CHECK_EQ(s_heap_count, 0);
+}
+
+static void test_exhausted(void)
+{
+  Timer timers[TIMER_POOL_SIZE];
+
+  for (uint8_t i = 0; i < TIMER_POOL_SIZE; i++)
+  {
+    timers[i] = timer_create();
+    CHECK(timers[i] != NULL);
+  }
+  CHECK(timer_create() == NULL);
+
+  // a freed slot is handed out again, zeroed
+  sTimer *used = timers[2];
+  timer_set_length(used, 60);
+  timer_set_interval_vibration(used, 10);
+  timer_start(used);
+  timer_destroy(used);
+
+  Timer again = timer_create();
+  CHECK(again == (Timer)used);
+  sTimer zero;
+  memset(&zero, 0, sizeof(zero));
+  CHECK(memcmp(again, &zero, sizeof(zero)) == 0);
+
+  timers[2] = again;
+  for (uint8_t i = 0; i < TIMER_POOL_SIZE; i++)
+    timer_destroy(timers[i]);
+  CHECK_EQ(s_pool_used, 0);
+  CHECK_EQ(s_pool_peak, TIMER_POOL_SIZE);
+  CHECK_EQ(s_heap_calls, 0);
+}
+
+int main(void)
+{
+  test_stress();
+  test_exhausted();
+  return TEST_RESULT("test_timer_pool");
+}
@@ -0,0 +1,80 @@
+// The timer only wakes up when the shown time changes or an alert is due,
+// counted through timer_debug_wakeups_per_minute().
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "timer.h"
+
+static Timer s_timer;
+static uint32_t s_last_time;
+static uint32_t s_unchanged = 0;
+
+// every wakeup changes what is shown
+static void update_cb(void* context)
+{
+  uint32_t time = timer_get_time(s_timer);
+  uint32_t step = *(uint32_t*)context;
+
+  if (time / step == s_last_time / step)
+    s_unchanged++;
+  s_last_time = time;
+}
+
+static uint32_t vibe_patterns(void)
+{
+  uint32_t count = 0;
+  for (uint32_t i = 0; i < shim_vibes_count(); i++)
+  {
+    if (shim_vibe(i)->kind == SHIM_VIBE_PATTERN)
+      count++;
+  }
+  return count;
+}
+
+// Wakeups in the last full minute of a 3 minute run
+static uint32_t wakeups_per_minute(uint32_t length, TimerResolution res, uint32_t interval)
+{
+  uint32_t step = (res == TIMER_RES_SECOND) ? 10 : 1;
+  uint32_t wakeups;
+
+  s_unchanged = 0;
+  s_timer = timer_create();
+  timer_set_length(s_timer, length);
+  timer_set_display_resolution(s_timer, res);
+  timer_set_interval_vibration(s_timer, interval);
+  timer_register_update_cb(s_timer, update_cb, &step);
+
+  s_last_time = timer_get_time(s_timer);
+  timer_start(s_timer);
+  shim_run_for(3 * 60 * 1000);
+  wakeups = timer_debug_wakeups_per_minute();
+
+  // interval alerts may wake the timer without a change
+  if (interval == 0)
+    CHECK_EQ(s_unchanged, 0);
+
+  timer_destroy(s_timer);
+  return wakeups;
+}
+
+int main(void)
+{
+  uint32_t tenth = wakeups_per_minute(600, TIMER_RES_TENTH, 0);
+  uint32_t second = wakeups_per_minute(600, TIMER_RES_SECOND, 0);
+  uint32_t stopwatch = wakeups_per_minute(0, TIMER_RES_SECOND, 0);
+  shim_vibes_clear();
+  uint32_t interval = wakeups_per_minute(600, TIMER_RES_SECOND, 15);
+  CHECK_EQ(vibe_patterns(), 12);
+
+  // the minute is counted up to and with the wakeup that ends it
+  CHECK(tenth >= 600 && tenth <= 601);
+  CHECK(second >= 60 && second <= 61);
+  CHECK(stopwatch >= 60 && stopwatch <= 61);
+  // interval alerts fall on whole seconds, they share the wakeup
+  CHECK(interval >= 60 && interval <= 61);
+  CHECK(tenth >= 10 * second - 10);
+
+  fprintf(stderr, "wakeups/min: tenth %u, second %u, stopwatch %u, interval %u\n",
+          (unsigned)tenth, (unsigned)second, (unsigned)stopwatch, (unsigned)interval);
+  return TEST_RESULT("test_timer_wakeups");
+}
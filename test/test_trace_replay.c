@@ -0,0 +1,290 @@
+// Trace replay: the records of a trace dump are run again through the race
+// timer, the events from the buttons at the time they were handled, and the
+// states, expiries and vibes it gives are compared with the recorded ones.
+//
+//   build/test_trace_replay            record a heat, replay its dump
+//   build/test_trace_replay FILE       replay the dump in an app log
+//
+// A recorded output may come later than the replayed one by a late wakeup
+// and a late queue run, each up to the latest wakeup of the trace. The replay runs the default profile, a trace
+// of another profile diverges at its first phase end. A dump of a full ring
+// buffer starts in the middle of what was recorded and diverges at once.
+
+#include <ctype.h>
+#include "pebble_shim.h"
+#include "test.h"
+#include "raceTimer/raceTimer.c"
+
+#define REPLAY_MAX_RECORDS  TRACE_SIZE
+
+typedef struct {
+  uint64_t  at_ms;
+  uint8_t   type;
+  uint8_t   arg;
+} replay_record_t;
+
+typedef struct {
+  uint64_t        start_ms;
+  uint16_t        count;
+  replay_record_t records[REPLAY_MAX_RECORDS];
+} replay_trace_t;
+
+static replay_trace_t s_field;
+static replay_trace_t s_replay;
+static replay_trace_t *s_parsing;
+static uint64_t s_offset_ms;        // replayed time - recorded time
+
+static const char *TYPE_NAMES[] = { "EVENT", "STATE", "TICK", "VIBE" };
+
+/******************************************************************************
+  Dump parser, the TRACE lines written by trace_dump()
+******************************************************************************/
+static void replay_parse_line(const char *line)
+{
+  unsigned sec, ms, count;
+  const char *p = strstr(line, "TRACE ");
+
+  if (p == NULL || s_parsing == NULL)
+    return;
+  p += strlen("TRACE ");
+
+  if (sscanf(p, "start %u.%u records %u", &sec, &ms, &count) == 3)
+  {
+    s_parsing->start_ms = (uint64_t)sec * 1000 + ms;
+    s_parsing->count = 0;
+    return;
+  }
+
+  // a line of whole records and nothing else
+  size_t digits = strspn(p, "0123456789abcdef");
+  if (digits == 0 || digits % (2 * sizeof(trace_record_t)) || (p[digits] && !isspace((unsigned char)p[digits])))
+    return;
+
+  uint64_t at_ms = s_parsing->count ? s_parsing->records[s_parsing->count - 1].at_ms : s_parsing->start_ms;
+  for (const char *end = p + digits; p < end; p += 2 * sizeof(trace_record_t))
+  {
+    uint8_t bytes[sizeof(trace_record_t)];
+    trace_record_t record;
+
+    for (uint8_t b = 0; b < sizeof(bytes); b++)
+    {
+      unsigned byte;
+      if (sscanf(p + 2 * b, "%2x", &byte) != 1)
+        return;
+      bytes[b] = byte;
+    }
+    memcpy(&record, bytes, sizeof(record));
+    if (s_parsing->count == REPLAY_MAX_RECORDS)
+      return;
+
+    at_ms += record.dt_ms;
+    s_parsing->records[s_parsing->count++] = (replay_record_t) {
+      .at_ms = at_ms, .type = record.type, .arg = record.arg,
+    };
+  }
+}
+
+// The trace recorded so far, through the log as the app dumps it
+static void replay_dump(replay_trace_t *trace)
+{
+  memset(trace, 0, sizeof(*trace));
+  s_parsing = trace;
+  shim_set_log_handler(replay_parse_line);
+  trace_dump();
+  shim_set_log_handler(NULL);
+  s_parsing = NULL;
+}
+
+static bool replay_read(const char *path, replay_trace_t *trace)
+{
+  char line[512];
+  FILE *file = fopen(path, "r");
+
+  if (file == NULL)
+    return false;
+  memset(trace, 0, sizeof(*trace));
+  s_parsing = trace;
+  while (fgets(line, sizeof(line), file))
+    replay_parse_line(line);
+  s_parsing = NULL;
+  fclose(file);
+  return true;
+}
+
+/******************************************************************************
+  Replay
+******************************************************************************/
+// The events handled because of a button, the others follow from them
+static bool replay_is_input(const replay_record_t *record)
+{
+  return record->type == TRACE_EVENT && (record->arg & 0x0F) != EVENT_TIMER_EXPIRED;
+}
+
+static bool replay_is_output(const replay_record_t *record)
+{
+  return record->type != TRACE_TICK && !replay_is_input(record);
+}
+
+// Runs the inputs of the field trace from a stopped race timer, the trace
+// recorded meanwhile is the replayed one. The clock only goes forward, the
+// replay starts on the next whole second after the vibes have ended.
+static void replay_run(const replay_trace_t *field)
+{
+  if (state != STATE_STOPPED)
+    racetimer_event_handler(EVENT_CLICK_UP);
+  shim_set_jitter(0, 0);
+  shim_run_for(5000);
+  s_offset_ms = (shim_now_ms() - field->start_ms + 999) / 1000 * 1000;
+  trace_clear();
+
+  for (uint16_t i = 0; i < field->count; i++)
+  {
+    const replay_record_t *record = &field->records[i];
+    if (!replay_is_input(record))
+      continue;
+    shim_run_until(record->at_ms + s_offset_ms);
+    racetimer_event_handler_with_clicks(record->arg & 0x0F, record->arg >> 4);
+  }
+  if (field->count)
+    shim_run_until(field->records[field->count - 1].at_ms + s_offset_ms);
+  replay_dump(&s_replay);
+}
+
+static void replay_print(const char *name, uint64_t start_ms, const replay_record_t *record)
+{
+  if (record)
+    fprintf(stderr, "  %s %s %u at %.3f s\n", name, TYPE_NAMES[record->type % 4],
+            (unsigned)record->arg, (double)(record->at_ms - start_ms) / 1000);
+  else
+    fprintf(stderr, "  %s ends\n", name);
+}
+
+static const replay_record_t* replay_next_output(const replay_trace_t *trace, uint16_t *index)
+{
+  while (*index < trace->count && !replay_is_output(&trace->records[*index]))
+    (*index)++;
+  return (*index < trace->count) ? &trace->records[(*index)++] : NULL;
+}
+
+// Returns the number of outputs matched, -1 if the replay diverged
+static int32_t replay_compare(const replay_trace_t *field, const replay_trace_t *replay, bool verbose)
+{
+  uint32_t ticks = 0, late_sum = 0, late_max = 0;
+  uint16_t f = 0, r = 0;
+  int32_t matched = 0;
+
+  for (uint16_t i = 0; i < field->count; i++)
+  {
+    if (field->records[i].type != TRACE_TICK)
+      continue;
+    ticks++;
+    late_sum += field->records[i].arg;
+    if (field->records[i].arg > late_max)
+      late_max = field->records[i].arg;
+  }
+  if (verbose)
+    fprintf(stderr, "trace: %u records over %.1f s, %u ticks late by %u ms on average, %u ms at most\n",
+            (unsigned)field->count,
+            field->count ? (double)(field->records[field->count - 1].at_ms - field->start_ms) / 1000 : 0.0,
+            (unsigned)ticks, ticks ? (unsigned)(late_sum / ticks) : 0, (unsigned)late_max);
+
+  for (;;)
+  {
+    const replay_record_t *fr = replay_next_output(field, &f);
+    const replay_record_t *rr = replay_next_output(replay, &r);
+
+    if (fr == NULL && rr == NULL)
+      break;
+    if (fr == NULL || rr == NULL || fr->type != rr->type || fr->arg != rr->arg ||
+        fr->at_ms + s_offset_ms < rr->at_ms || fr->at_ms + s_offset_ms > rr->at_ms + 2 * late_max)
+    {
+      if (verbose)
+      {
+        fprintf(stderr, "replay diverges after %d outputs:\n", (int)matched);
+        replay_print("recorded", field->start_ms, fr);
+        replay_print("replayed", field->start_ms + s_offset_ms, rr);
+      }
+      return -1;
+    }
+    matched++;
+  }
+  if (verbose)
+    fprintf(stderr, "replay matches all %d outputs\n", (int)matched);
+  return matched;
+}
+
+/******************************************************************************
+  Self test
+******************************************************************************/
+// A heat with late wakeups: started, paused, resumed, run through the race
+// and reset in the after race phase
+static void record_heat(void)
+{
+  shim_set_jitter(40, 7);
+  trace_clear();
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(20 * 1000);
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(3 * 1000);
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(300 * 1000);
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(1000);
+  shim_set_jitter(0, 0);
+  replay_dump(&s_field);
+}
+
+static void test_replay(void)
+{
+  record_heat();
+  CHECK(s_field.count > 0 && s_field.count < TRACE_SIZE);
+  CHECK_EQ(s_field.records[0].type, TRACE_EVENT);
+  CHECK_EQ(s_field.records[0].arg, EVENT_CLICK_DOWN);
+  CHECK_EQ(s_field.records[s_field.count - 1].type, TRACE_STATE);
+  CHECK_EQ(s_field.records[s_field.count - 1].arg, STATE_STOPPED);
+  CHECK_EQ(state, STATE_STOPPED);
+
+  // the same inputs give the same outputs, the 4 interval and 15 warning
+  // vibes of the race and its end included
+  replay_run(&s_field);
+  int32_t outputs = replay_compare(&s_field, &s_replay, false);
+  CHECK(outputs > 0);
+  uint16_t vibes = 0;
+  for (uint16_t i = 0; i < s_replay.count; i++)
+    vibes += (s_replay.records[i].type == TRACE_VIBE);
+  CHECK_EQ(vibes, 4 + 15 + 1);
+
+  // the heat resumed 2 s later ends 2 s later
+  for (uint16_t i = 0, down = 0; i < s_field.count; i++)
+  {
+    replay_record_t *record = &s_field.records[i];
+    if (replay_is_input(record) && (record->arg & 0x0F) == EVENT_CLICK_DOWN && ++down == 3)
+      record->at_ms += 2000;
+  }
+  replay_run(&s_field);
+  CHECK_EQ(replay_compare(&s_field, &s_replay, false), -1);
+}
+
+int main(int argc, char *argv[])
+{
+  settings_init();
+  racetimer_init();
+
+  if (argc > 1)
+  {
+    if (!replay_read(argv[1], &s_field) || s_field.count == 0)
+    {
+      fprintf(stderr, "%s: no trace dump\n", argv[1]);
+      return 2;
+    }
+    replay_run(&s_field);
+    return (replay_compare(&s_field, &s_replay, true) < 0) ? 1 : 0;
+  }
+
+  test_replay();
+
+  window_stack_pop(false);
+  racetimer_deinit();
+  settings_deinit();
+  return TEST_RESULT("test_trace_replay");
+}
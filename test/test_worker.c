@@ -0,0 +1,149 @@
+// The background worker and the race timer over the worker message bus: a
+// heat handed over when the app is closed, the app launched again at the
+// start of the EOR warning and at each phase end, and the worker told to
+// forget the heat or killed when it is not needed.
+
+#include "pebble_shim.h"
+#include "test.h"
+#include "settings/settings.h"
+#include "raceTimer/raceTimer.h"
+
+#define main worker_main
+#include "../worker_src/c/worker.c"
+#undef main
+
+static uint64_t s_start_sec;
+
+static void app_open(void)
+{
+  racetimer_init();
+}
+
+static void app_close(void)
+{
+  window_stack_pop(false);
+  racetimer_deinit();
+}
+
+// The launch times stored for the worker, since the heat was started
+static uint8_t stored_launches(uint32_t *launch)
+{
+  worker_heat_t heat;
+  uint8_t n = 0;
+
+  if (persist_read_data(WORKER_HEAT_KEY, &heat, sizeof(heat)) != sizeof(heat))
+    return 0;
+  for (uint8_t i = 0; i < WORKER_MAX_LAUNCHES; i++)
+  {
+    if (heat.launch[i])
+      launch[n++] = heat.launch[i] - s_start_sec;
+  }
+  return n;
+}
+
+static bool worker_has_heat(void)
+{
+  for (uint8_t i = 0; i < WORKER_MAX_LAUNCHES; i++)
+  {
+    if (s_heat.launch[i])
+      return true;
+  }
+  return false;
+}
+
+// Default profile: a 5 s pre race, a 300 s race with a 15 s warning and an
+// after race phase counting up
+static void test_heat(void)
+{
+  uint32_t launch[WORKER_MAX_LAUNCHES];
+
+  shim_run_until((shim_now_ms() / 1000 + 1) * 1000);
+  s_start_sec = shim_now_ms() / 1000;
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(1000);
+
+  // closed in the pre race, the worker is launched with the whole heat
+  app_close();
+  CHECK(app_worker_is_running());
+  CHECK_EQ(stored_launches(launch), 3);
+  CHECK_EQ(launch[0], 5);
+  CHECK_EQ(launch[1], 290);
+  CHECK_EQ(launch[2], 305);
+
+  // the pre race end opens the app, which stops the worker's heat
+  shim_run_until((s_start_sec + 5) * 1000 + 500);
+  CHECK_EQ(shim_worker_app_launches(), 1);
+  CHECK(shim_top_window() != NULL);
+  CHECK(app_worker_is_running());
+  CHECK(!worker_has_heat());
+  CHECK(!persist_exists(WORKER_HEAT_KEY));
+
+  // closed again, the running worker is told of the new heat
+  app_close();
+  CHECK_EQ(stored_launches(launch), 2);
+  CHECK_EQ(launch[0], 290);
+  CHECK_EQ(launch[1], 305);
+  CHECK(worker_has_heat());
+  shim_run_until((s_start_sec + 289) * 1000);
+  CHECK_EQ(shim_worker_app_launches(), 1);
+
+  // the warning opens the app, closed once more the race end does
+  shim_run_until((s_start_sec + 290) * 1000 + 500);
+  CHECK_EQ(shim_worker_app_launches(), 2);
+  app_close();
+  CHECK_EQ(stored_launches(launch), 1);
+  CHECK_EQ(launch[0], 305);
+  shim_run_until((s_start_sec + 305) * 1000 + 500);
+  CHECK_EQ(shim_worker_app_launches(), 3);
+
+  // nothing left to wait for in the after race phase
+  app_close();
+  CHECK(!app_worker_is_running());
+  CHECK(!persist_exists(WORKER_HEAT_KEY));
+  shim_run_for(60 * 1000);
+  CHECK_EQ(shim_worker_app_launches(), 3);
+  app_open();
+  shim_click(BUTTON_ID_UP, 1);
+}
+
+// A paused heat does not need the worker, a stopped one neither. A click
+// is handled on the next queue run, before the app is closed.
+static void test_paused(void)
+{
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(1000);
+  app_close();
+  CHECK(app_worker_is_running());
+
+  app_open();
+  CHECK(app_worker_is_running());
+  CHECK(!worker_has_heat());
+  shim_click(BUTTON_ID_DOWN, 1);
+  shim_run_for(0);
+  app_close();
+  CHECK(!app_worker_is_running());
+  CHECK(!persist_exists(WORKER_HEAT_KEY));
+
+  app_open();
+  shim_click(BUTTON_ID_UP, 1);
+  shim_run_for(0);
+  app_close();
+  CHECK(!app_worker_is_running());
+  CHECK_EQ(shim_worker_app_launches(), 0);
+  app_open();
+}
+
+int main(void)
+{
+  settings_init();
+  shim_worker_set(worker_init, worker_deinit, app_open);
+  app_open();
+
+  test_heat();
+  shim_worker_set(worker_init, worker_deinit, app_open);
+  test_paused();
+
+  app_close();
+  settings_deinit();
+  return TEST_RESULT("test_worker");
+}
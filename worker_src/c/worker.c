@@ -0,0 +1,86 @@
+#include <pebble_worker.h>
+#include "worker_msg.h"
+
+// Keeps track of a running heat while the app is closed. The race clock is
+// derived from the wall clock, so the worker only needs the times the app
+// has to be in front: the start of an EOR warning and the end of a phase.
+// The app is launched then to show the heat and give the alerts, a worker
+// can not vibrate itself. The intervals and alert points of a phase are not
+// given while the app is closed.
+
+static worker_heat_t s_heat;
+
+static void worker_tick_handler(struct tm *tick_time, TimeUnits units_changed)
+{
+  uint32_t now = time(NULL);
+  bool launch = false;
+  bool pending = false;
+
+  for (uint8_t i = 0; i < WORKER_MAX_LAUNCHES; i++)
+  {
+    if (s_heat.launch[i] && now >= s_heat.launch[i])
+    {
+      s_heat.launch[i] = 0;
+      launch = true;
+    }
+    pending |= (s_heat.launch[i] != 0);
+  }
+
+  if (!pending)
+  {
+    tick_timer_service_unsubscribe();
+  }
+  if (launch)
+  {
+    worker_launch_app();
+  }
+}
+
+static void worker_load_heat(void)
+{
+  memset(&s_heat, 0, sizeof(s_heat));
+  persist_read_data(WORKER_HEAT_KEY, &s_heat, sizeof(s_heat));
+
+  tick_timer_service_unsubscribe();
+  for (uint8_t i = 0; i < WORKER_MAX_LAUNCHES; i++)
+  {
+    if (s_heat.launch[i])
+    {
+      tick_timer_service_subscribe(SECOND_UNIT, worker_tick_handler);
+      break;
+    }
+  }
+}
+
+static void worker_message_handler(uint16_t type, AppWorkerMessage *message)
+{
+  switch (type)
+  {
+    case WORKER_MSG_HEAT_CHANGED:
+      worker_load_heat();
+      break;
+    case WORKER_MSG_HEAT_STOP:
+      memset(&s_heat, 0, sizeof(s_heat));
+      tick_timer_service_unsubscribe();
+      break;
+  }
+}
+
+static void worker_init(void)
+{
+  worker_load_heat();
+  app_worker_message_subscribe(worker_message_handler);
+}
+
+static void worker_deinit(void)
+{
+  app_worker_message_unsubscribe();
+  tick_timer_service_unsubscribe();
+}
+
+int main(void)
+{
+  worker_init();
+  worker_event_loop();
+  worker_deinit();
+}